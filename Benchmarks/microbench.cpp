@@ -0,0 +1,185 @@
+// микрозамеры отдельных частей поиска (Google Benchmark): генерация ходов для простых шашек и дамок,
+// выполнение хода, оценка позиции обоими типами оценки и копирование доски.
+// позиции: начальная (только простые) и окончание с дамками, у которых дальние ходы по диагоналям.
+// ядра доски 10x10 замеряются на ее начальной позиции
+#include <benchmark/benchmark.h>
+
+#include "../Game/Logic.h"
+#include "../Models/Notation.h"
+
+namespace
+{
+const char *const men_fen = "W:W21,22,23,24,25,26,27,28,29,30,31,32:B1,2,3,4,5,6,7,8,9,10,11,12";
+const char *const kings_fen = "W:WK18,K27,K30,K31:BK3,K7,K10,K12";
+
+vector<vector<POS_T>> board(const char *fen)
+{
+    packed_pos pos;
+    bool color;
+    notation::parse_fen(fen, pos, color);
+    return pos.to_mtx();
+}
+
+// поиск с настройками по умолчанию, без settings.json и без случайности
+Logic &logic()
+{
+    static Config config([]() {
+        settings s;
+        s.no_random = true;
+        return s;
+    }());
+    static Logic res(&config);
+    return res;
+}
+
+// все ходы белых в позиции
+void find_turns_side(benchmark::State &state, const char *fen)
+{
+    const auto mtx = board(fen);
+    Logic &l = logic();
+    for (auto _ : state)
+    {
+        l.find_turns(false, mtx);
+        benchmark::DoNotOptimize(l.turns.data());
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(l.turns.size()));
+}
+BENCHMARK_CAPTURE(find_turns_side, men, men_fen);
+BENCHMARK_CAPTURE(find_turns_side, kings, kings_fen);
+
+// ходы одной фигуры: простая шашка 22 и дамка 18
+void find_turns_piece(benchmark::State &state, const char *fen, const int square)
+{
+    const auto mtx = board(fen);
+    POS_T x, y;
+    notation::cell(square, x, y);
+    Logic &l = logic();
+    for (auto _ : state)
+    {
+        l.find_turns(x, y, mtx);
+        benchmark::DoNotOptimize(l.turns.data());
+    }
+}
+BENCHMARK_CAPTURE(find_turns_piece, man, men_fen, 22);
+BENCHMARK_CAPTURE(find_turns_piece, king, kings_fen, 18);
+
+// выполнение каждого хода позиции на упакованной доске
+void make_turn_packed(benchmark::State &state, const char *fen)
+{
+    const auto mtx = board(fen);
+    const packed_pos pos(mtx);
+    Logic &l = logic();
+    l.find_turns(false, mtx);
+    const vector<move_pos> turns = l.turns;
+    for (auto _ : state)
+    {
+        for (const auto &turn : turns)
+            benchmark::DoNotOptimize(pos.make_turn(turn));
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(turns.size()));
+}
+BENCHMARK_CAPTURE(make_turn_packed, men, men_fen);
+BENCHMARK_CAPTURE(make_turn_packed, kings, kings_fen);
+
+// выполнение хода с переводом в матрицу и обратно, как при разборе ходов протокола
+void make_turn_mtx(benchmark::State &state, const char *fen)
+{
+    const auto mtx = board(fen);
+    Logic &l = logic();
+    l.find_turns(false, mtx);
+    const vector<move_pos> turns = l.turns;
+    for (auto _ : state)
+    {
+        for (const auto &turn : turns)
+            benchmark::DoNotOptimize(packed_pos(mtx).make_turn(turn).to_mtx());
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(turns.size()));
+}
+BENCHMARK_CAPTURE(make_turn_mtx, men, men_fen);
+
+// оценка одной позиции
+void calc_score(benchmark::State &state, const char *type, const char *fen)
+{
+    const auto eval = Evaluators::make(type, json::object());
+    const packed_pos pos(board(fen));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(eval->score(pos, true));
+}
+BENCHMARK_CAPTURE(calc_score, number_only_men, "NumberOnly", men_fen);
+BENCHMARK_CAPTURE(calc_score, number_and_potential_men, "NumberAndPotential", men_fen);
+BENCHMARK_CAPTURE(calc_score, number_only_kings, "NumberOnly", kings_fen);
+BENCHMARK_CAPTURE(calc_score, number_and_potential_kings, "NumberAndPotential", kings_fen);
+
+// оценка всех дочерних позиций пакетом, как при упорядочивании ходов
+void calc_score_batch(benchmark::State &state, const char *type)
+{
+    const auto eval = Evaluators::make(type, json::object());
+    const auto mtx = board(men_fen);
+    const packed_pos pos(mtx);
+    Logic &l = logic();
+    l.find_turns(false, mtx);
+    pos_batch batch;
+    for (const auto &turn : l.turns)
+        batch.push(pos.make_turn(turn));
+    vector<double> scores(l.turns.size());
+    for (auto _ : state)
+    {
+        eval->score(batch, true, scores.data());
+        benchmark::DoNotOptimize(scores.data());
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(scores.size()));
+}
+BENCHMARK_CAPTURE(calc_score_batch, number_only, "NumberOnly");
+BENCHMARK_CAPTURE(calc_score_batch, number_and_potential, "NumberAndPotential");
+
+// ядра, специализированные под геометрию доски: генерация ходов и скалярная оценка 8x8 и 10x10
+// (начальные позиции, 7 и 9 ходов белых)
+template <class G> void movegen_side(benchmark::State &state)
+{
+    const auto mtx = basic_packed_pos<G>::start().to_mtx();
+    move_list_of<G> list;
+    for (auto _ : state)
+    {
+        movegen<G>::side_turns(false, mtx, list);
+        benchmark::DoNotOptimize(list.moves);
+    }
+    state.SetItemsProcessed(state.iterations() * int64_t(list.size()));
+}
+BENCHMARK_TEMPLATE(movegen_side, geometry8);
+BENCHMARK_TEMPLATE(movegen_side, geometry10);
+
+template <class G> void eval_geometry(benchmark::State &state)
+{
+    const eval_weights weights;
+    const auto pos = basic_packed_pos<G>::start();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Batch_eval::score(pos, weights, true));
+}
+BENCHMARK_TEMPLATE(eval_geometry, geometry8);
+BENCHMARK_TEMPLATE(eval_geometry, geometry10);
+
+// копирование доски: матрица 8x8 (так поиск копирует позицию на каждом ходе) и упакованная позиция
+void board_copy_mtx(benchmark::State &state)
+{
+    const auto mtx = board(men_fen);
+    for (auto _ : state)
+    {
+        auto copy = mtx;
+        benchmark::DoNotOptimize(copy.data());
+    }
+}
+BENCHMARK(board_copy_mtx);
+
+void board_copy_packed(benchmark::State &state)
+{
+    const packed_pos pos(board(men_fen));
+    for (auto _ : state)
+    {
+        packed_pos copy = pos;
+        benchmark::DoNotOptimize(copy);
+    }
+}
+BENCHMARK(board_copy_packed);
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,263 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <sstream>
+
+#include "../Models/Notation.h"
+#include "Logic.h"
+
+// ограничения поиска команды go (0 - без ограничения)
+struct search_limits
+{
+    size_t depth = 0;
+    long long movetime = 0;
+    size_t nodes = 0;
+    size_t multipv = 1; // число лучших ходов с оценками и вариантами
+
+    // разбор "[depth N] [movetime MS] [nodes N] [multipv N]"
+    static search_limits parse(istream &in)
+    {
+        search_limits limits;
+        string word;
+        while (in >> word)
+        {
+            if (word == "depth")
+                in >> limits.depth;
+            else if (word == "movetime")
+                in >> limits.movetime;
+            else if (word == "nodes")
+                in >> limits.nodes;
+            else if (word == "multipv")
+                in >> limits.multipv;
+        }
+        return limits;
+    }
+
+    bool infinite() const
+    {
+        return !depth && !movetime && !nodes;
+    }
+};
+
+// результат одной итерации углубления
+struct search_info
+{
+    size_t depth = 0;
+    size_t multipv = 0; // номер варианта с 1 в режиме нескольких вариантов, 0 - один вариант
+    double score = 0;
+    size_t nodes = 0;
+    long long time_ms = 0;
+    vector<move_pos> pv;
+
+    // строка info протокола
+    string text() const
+    {
+        return "info depth " + to_string(depth) + (multipv ? " multipv " + to_string(multipv) : "") + " score " +
+               score_text(score) + " nodes " + to_string(nodes) + " nps " +
+               to_string(time_ms ? nodes * 1000 / time_ms : nodes * 1000) + " time " + to_string(time_ms) + " pv " +
+               pv_text(pv);
+    }
+
+    // оценка для ходящей стороны: "cp" - логарифм отношения сил, умноженный на 100, "win"/"loss" - конец игры
+    static string score_text(const double score)
+    {
+        if (score >= INF)
+            return "win";
+        if (score <= 0)
+            return "loss";
+        return "cp " + to_string(lround(100 * log(score)));
+    }
+
+    // главный вариант: взятия одной серии объединяются в один ход
+    static string pv_text(const vector<move_pos> &pv)
+    {
+        string res;
+        vector<move_pos> series;
+        for (const auto &turn : pv)
+        {
+            const bool continues = !series.empty() && series.back().xb != -1 && turn.xb != -1 &&
+                                   turn.x == series.back().x2 && turn.y == series.back().y2;
+            if (!continues && !series.empty())
+            {
+                res += (res.empty() ? "" : " ") + notation::move(series);
+                series.clear();
+            }
+            series.push_back(turn);
+        }
+        if (!series.empty())
+            res += (res.empty() ? "" : " ") + notation::move(series);
+        return res;
+    }
+};
+
+// позиция и поиск для текстового протокола (Tools/engine.cpp, Tools/service.cpp)
+class Analysis
+{
+public:
+    Analysis(Config *config, Transposition *tt = nullptr) : logic(config, tt), mtx(packed_pos::start().to_mtx())
+    {
+    }
+
+    // разбор "startpos [moves m1 m2 ...]" или "fen <fen> [moves ...]", возвращает текст ошибки или пустую строку.
+    // при ошибке в ходах позиция остается после последнего правильного хода
+    string set_position(istream &in)
+    {
+        string word;
+        in >> word;
+        packed_pos pos = packed_pos::start();
+        color = false;
+        string error;
+        if (word == "fen")
+        {
+            string fen;
+            in >> fen;
+            if (!notation::parse_fen(fen, pos, color))
+            {
+                pos = packed_pos::start();
+                color = false;
+                error = "bad fen " + fen;
+            }
+        }
+        else if (word != "startpos")
+            error = "position needs startpos or fen";
+        mtx = pos.to_mtx();
+        // ходы после позиции попадают в историю партии: поиск учитывает повторения
+        logic.history.clear();
+        logic.history.push(pos, color);
+        in >> word;
+        if (!error.empty() || word != "moves")
+            return error;
+        while (in >> word)
+        {
+            if (!apply_move(word))
+                return "illegal move " + word;
+        }
+        return "";
+    }
+
+    // выполнение хода в записи "22-18" или "23x14x5", серия взятий должна быть полной
+    bool apply_move(const string &text)
+    {
+        vector<int> squares;
+        bool is_beat;
+        if (!notation::parse_move(text, squares, is_beat))
+            return false;
+        auto res = mtx;
+        logic.find_turns(color, res);
+        POS_T x = -1, y = -1, x2 = -1, y2 = -1;
+        for (size_t k = 1; k < squares.size(); ++k)
+        {
+            if (!notation::cell(squares[k - 1], x, y) || !notation::cell(squares[k], x2, y2))
+                return false;
+            if (k > 1)
+                logic.find_turns(x, y, res);
+            bool found = false;
+            for (const auto &turn : logic.turns)
+            {
+                if (turn.x == x && turn.y == y && turn.x2 == x2 && turn.y2 == y2 && (turn.xb != -1) == is_beat)
+                {
+                    res = packed_pos(res).make_turn(turn).to_mtx();
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+                return false;
+        }
+        // серия взятий не может прерываться
+        if (is_beat)
+        {
+            logic.find_turns(x2, y2, res);
+            if (logic.have_beats)
+                return false;
+        }
+        mtx = res;
+        color = !color;
+        logic.history.push(packed_pos(mtx), color);
+        return true;
+    }
+
+    // итеративное углубление: глубина d ищется с Max_depth = d - 1, как уровень бота в игре.
+    // в детерминированном режиме (Deterministic) movetime переводится в узлы по NodesPerMS.
+    // лимит узлов, срок movetime и флаг stop прерывают и текущую итерацию; новая итерация
+    // не начинается, если прошла половина времени.
+    // report вызывается после каждой полной итерации, с multipv > 1 - по разу на каждый из лучших ходов
+    // (варианты одного поиска корня, см. Logic::lines). возвращает лучшую серию ходов (пустую, если ходов нет)
+    vector<move_pos> search(const search_limits &limits, const atomic<bool> &stop,
+                            const function<void(const search_info &)> &report)
+    {
+        trace_scope trace("go");
+        const auto start = chrono::steady_clock::now();
+        // перезагруженные настройки применяются перед поиском, а не между итерациями
+        logic.update_settings();
+        // в детерминированном режиме время заменяется лимитом узлов, чтобы результат не зависел от скорости машины
+        const settings &s = *logic.snapshot();
+        const size_t node_budget = s.deterministic ? size_t(limits.movetime) * s.nodes_per_ms : 0;
+        const long long movetime = s.deterministic ? 0 : limits.movetime;
+        vector<move_pos> best;
+        logic.find_turns(color, mtx);
+        if (logic.turns.empty())
+            return best;
+        search_info info;
+        const size_t max_depth = limits.depth ? limits.depth : 64;
+        logic.stop = &stop;
+        if (movetime)
+            logic.deadline = start + chrono::milliseconds(movetime);
+        logic.multi_pv = max<size_t>(1, limits.multipv);
+        for (size_t depth = 1; depth <= max_depth; ++depth)
+        {
+            logic.Max_depth = depth - 1;
+            logic.Max_nodes = limits.nodes ? limits.nodes - min(info.nodes, limits.nodes - 1) : 0;
+            auto res = logic.find_best_turns(color, mtx);
+            info.nodes += logic.nodes;
+            if (logic.aborted)
+            {
+                // из прерванной итерации берется досчитанный ход корня, иначе остается ход прошлой итерации
+                if (best.empty() || logic.last_score >= 0)
+                    best = res;
+                break;
+            }
+            best = res;
+            info.depth = depth;
+            info.score = logic.last_score;
+            info.time_ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+            info.pv = logic.pv();
+            if (logic.multi_pv == 1)
+                report(info);
+            else
+            {
+                const auto &lines = logic.lines();
+                for (size_t k = 0; k < lines.size(); ++k)
+                {
+                    info.multipv = k + 1;
+                    info.score = lines[k].score;
+                    info.pv = lines[k].pv;
+                    report(info);
+                }
+            }
+            if (stop || (limits.nodes && info.nodes >= limits.nodes))
+                break;
+            // следующая глубина обычно в несколько раз дольше текущей: не начинать ее без запаса времени
+            if (movetime && info.time_ms * 2 >= movetime)
+                break;
+            if (node_budget && info.nodes * 2 >= node_budget)
+                break;
+            // выигрыш или проигрыш уже найден
+            if (logic.last_score >= INF || logic.last_score <= 0)
+                break;
+        }
+        logic.stop = nullptr;
+        logic.deadline = {};
+        logic.Max_nodes = 0;
+        logic.multi_pv = 1;
+        trace.arg("depth", (long long)info.depth);
+        trace.arg("nodes", (long long)info.nodes);
+        return best;
+    }
+
+    Logic logic;
+    vector<vector<POS_T>> mtx; // текущая позиция
+    bool color = false;        // ходящая сторона: false - белые, true - черные
+};
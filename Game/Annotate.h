@@ -0,0 +1,230 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include "Analysis.h"
+
+// ход партии: позиция до хода, ходящая сторона и сделанная серия (у последней позиции серия пустая)
+struct game_step
+{
+    vector<vector<POS_T>> mtx;
+    bool color = false;
+    vector<move_pos> series;
+};
+
+// оценка хода партии
+struct annotated_move
+{
+    size_t ply = 0;     // номер хода в партии с нуля
+    bool color = false; // ходящая сторона
+    string played;      // сделанный ход
+    string best;        // лучший ход поиска
+    int eval = 0;       // оценка позиции до хода в cp за белых (для графика партии)
+    int loss = 0;       // насколько сделанный ход хуже лучшего в cp для ходящей стороны
+    int man = 0;        // цена шашки ходящей стороны в позиции до хода в cp
+    string mark;        // "?!" - неточность, "?" - ошибка, "??" - грубая ошибка
+
+    json to_json() const
+    {
+        return {{"ply", ply},   {"side", color ? "black" : "white"}, {"move", played}, {"best", best},
+                {"eval", eval}, {"loss", loss},                      {"man", man},     {"mark", mark}};
+    }
+};
+
+// оценка каждого хода сыгранной партии: все позиции ищутся до заданной глубины или времени в нескольких
+// потоках с общей таблицей транспозиций, с конца партии к началу - поздние позиции попадают в поддеревья
+// ранних, и их записи в таблице уже готовы. потеря хода - разница оценки позиции до хода и оценки
+// позиции после него для той же стороны. оценка в cp - логарифм отношения сил, поэтому шашка стоит тем
+// меньше cp, чем больше фигур на доске (около 10 cp в середине игры), и пороги пометок задаются в долях
+// цены шашки в позиции до хода
+class Annotator
+{
+public:
+    static constexpr int max_cp = 2000;       // оценка выигрыша (и проигрыша со знаком минус) в cp
+    static constexpr double inaccuracy = 0.3; // пороги потери в долях цены шашки
+    static constexpr double mistake = 0.6;
+    static constexpr double blunder = 1.5;
+
+    Annotator(Config *config, Transposition *tt, const size_t threads)
+        : config(config), tt(tt), threads(max<size_t>(1, threads))
+    {
+    }
+
+    // восстановление ходов по позициям записи. в записи игры после каждого взятия серии своя позиция
+    // (Board::history_mtx), в записи матча - одна позиция после всей серии; подходят обе.
+    // первая ходящая сторона определяется по тому, чей ход связывает первые позиции.
+    // false если позиции не связаны ходами
+    static bool replay(const vector<packed_pos> &positions, vector<game_step> &steps)
+    {
+        for (const bool first_color : {false, true})
+        {
+            steps.clear();
+            bool color = first_color;
+            size_t k = 0;
+            bool linked = !positions.empty();
+            while (linked && k + 1 < positions.size())
+            {
+                const auto mtx = positions[k].to_mtx();
+                vector<full_turn> turns;
+                full_turns(mtx, color, turns);
+                linked = false;
+                for (auto &turn : turns)
+                {
+                    const vector<packed_pos> &trail = turn.second;
+                    size_t next = 0;
+                    if (positions[k + 1] == trail.back())
+                        next = k + 1;
+                    else if (k + trail.size() < positions.size() &&
+                             equal(trail.begin(), trail.end(), positions.begin() + k + 1))
+                        next = k + trail.size();
+                    if (!next)
+                        continue;
+                    steps.push_back({mtx, color, move(turn.first)});
+                    k = next;
+                    color = !color;
+                    linked = true;
+                    break;
+                }
+            }
+            if (linked)
+            {
+                steps.push_back({positions[k].to_mtx(), color, {}});
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // оценки всех ходов партии из позиций записи (runtime_error, если позиции не связаны ходами
+    // или оценка остановлена флагом stop)
+    vector<annotated_move> annotate(const vector<packed_pos> &positions, const search_limits &limits,
+                                    const atomic<bool> *stop = nullptr) const
+    {
+        vector<game_step> steps;
+        if (!replay(positions, steps))
+            throw runtime_error("positions of the game are not connected by moves");
+        // потоки уже делят позиции: корень каждого поиска - в одном потоке, без помощников Threads
+        settings single = *config->snapshot();
+        single.threads = 1;
+        single.watch_settings = false;
+        Config search_config(single);
+        const atomic<bool> no_stop{false};
+        const atomic<bool> &stopped = stop ? *stop : no_stop;
+        // оценка позиции для ходящей стороны (отношение сил, как у поиска) и лучший ход
+        vector<double> scores(steps.size(), 0);
+        vector<string> best(steps.size());
+        atomic<size_t> taken{0};
+        auto work = [&]() {
+            Analysis analysis(&search_config, tt);
+            for (size_t k; !stopped && (k = taken.fetch_add(1)) < steps.size();)
+            {
+                const size_t i = steps.size() - 1 - k;
+                analysis.mtx = steps[i].mtx;
+                analysis.color = steps[i].color;
+                search_info last;
+                const auto res = analysis.search(limits, stopped, [&last](const search_info &info) { last = info; });
+                // позиция без ходов - проигрыш ходящей стороны
+                scores[i] = res.empty() ? 0 : last.score;
+                best[i] = notation::move(res);
+            }
+        };
+        vector<thread> pool;
+        for (size_t t = 1; t < threads; ++t)
+            pool.emplace_back(work);
+        work();
+        for (auto &th : pool)
+            th.join();
+        if (stopped)
+            throw runtime_error("annotation stopped");
+
+        // цена шашки - по оценке бота ходящей стороны, как у поиска
+        const auto s = search_config.snapshot();
+        const shared_ptr<const Evaluator> evals[2] = {Evaluators::make(s->eval_type(false), s->bot[0].eval),
+                                                      Evaluators::make(s->eval_type(true), s->bot[1].eval)};
+        vector<annotated_move> res;
+        for (size_t i = 0; i + 1 < steps.size(); ++i)
+        {
+            annotated_move m;
+            m.ply = i;
+            m.color = steps[i].color;
+            m.played = notation::move(steps[i].series);
+            m.best = best[i];
+            const int before = cp(scores[i]), after = -cp(scores[i + 1]);
+            m.eval = m.color ? -before : before;
+            m.loss = m.played == m.best ? 0 : max(0, before - after);
+            m.man = man_cp(*evals[m.color], packed_pos(steps[i].mtx), m.color);
+            const double men = double(m.loss) / m.man;
+            m.mark = men >= blunder ? "??" : men >= mistake ? "?" : men >= inaccuracy ? "?!" : "";
+            res.push_back(m);
+        }
+        return res;
+    }
+
+    // оценка поиска в cp, как в строке info протокола; выигрыш и проигрыш - ±max_cp
+    static int cp(const double score)
+    {
+        if (score >= INF)
+            return max_cp;
+        if (score <= 0)
+            return -max_cp;
+        return clamp(int(lround(100 * log(score))), 1 - max_cp, max_cp - 1);
+    }
+
+    // цена шашки стороны color в позиции в cp: на сколько в среднем падает оценка, если убрать одну из ее
+    // шашек (без шашек - одну из дамок). не меньше 1 cp
+    static int man_cp(const Evaluator &eval, const packed_pos &pos, const bool color)
+    {
+        const packed_pos::mask men = color ? pos.b : pos.w, kings = color ? pos.bq : pos.wq;
+        const packed_pos::mask pieces = men ? men : kings;
+        const int base = cp(eval.score(pos, color));
+        int sum = 0, count = 0;
+        for (packed_pos::mask rest = pieces; rest; rest &= rest - 1)
+        {
+            packed_pos less = pos;
+            const packed_pos::mask bit = rest & (0u - rest);
+            (color ? (men ? less.b : less.bq) : (men ? less.w : less.wq)) &= ~bit;
+            sum += base - cp(eval.score(less, color));
+            ++count;
+        }
+        return max(1, count ? sum / count : 1);
+    }
+
+private:
+    typedef movegen<geometry8> rules;
+    typedef pair<vector<move_pos>, vector<packed_pos>> full_turn; // серия и позиции после каждого ее хода
+
+    // все полные ходы стороны color: серии взятий до конца
+    static void full_turns(const vector<vector<POS_T>> &mtx, const bool color, vector<full_turn> &res)
+    {
+        move_list list;
+        rules::side_turns(color, mtx, list);
+        for (const auto &turn : list)
+            extend(mtx, turn, {}, res);
+    }
+
+    static void extend(const vector<vector<POS_T>> &mtx, const move_pos &turn, full_turn prefix,
+                       vector<full_turn> &res)
+    {
+        const auto next = rules::make_turn(mtx, turn);
+        prefix.first.push_back(turn);
+        prefix.second.emplace_back(next);
+        if (turn.xb != -1)
+        {
+            move_list more;
+            rules::piece_turns(turn.x2, turn.y2, next, more);
+            if (more.have_beats)
+            {
+                for (const auto &t : more)
+                    extend(next, t, prefix, res);
+                return;
+            }
+        }
+        res.push_back(move(prefix));
+    }
+
+    Config *config;
+    Transposition *tt; // общая таблица всех потоков
+    size_t threads;
+};
@@ -0,0 +1,211 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "Trace.h"
+
+#ifdef __APPLE__
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#else
+#include <SDL.h>
+#include <SDL_image.h>
+#endif
+
+using namespace std;
+
+// картинка атласа: файл и ширина, с которой она рисуется, в долях ширины окна
+struct atlas_image
+{
+    string path;
+    double width_share = 1;
+};
+
+// все текстуры окна в одной текстуре (атласе). png декодируются в фоновом потоке, пока создаются окно
+// и рендерер, затем уменьшаются до размера, с которым рисуются на весь экран, раскладываются полками
+// в одну картинку и загружаются в видеопамять за один раз. части атласа рисуются по своим прямоугольникам
+class Atlas
+{
+public:
+    Atlas() = default;
+    Atlas(const Atlas &) = delete;
+    Atlas &operator=(const Atlas &) = delete;
+
+    ~Atlas()
+    {
+        destroy();
+    }
+
+    // начало декодирования картинок в фоновом потоке
+    void start_loading(vector<atlas_image> list)
+    {
+        images = move(list);
+        decoded = async(launch::async, [paths = paths()]() {
+            Trace::name_thread("texture loader");
+            trace_scope trace("decode textures");
+            vector<SDL_Surface *> res;
+            for (const auto &path : paths)
+            {
+                SDL_Surface *loaded = IMG_Load(path.c_str());
+                // один формат пикселей для копирования в атлас без преобразований
+                SDL_Surface *rgba = loaded ? SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0) : nullptr;
+                if (loaded)
+                    SDL_FreeSurface(loaded);
+                res.push_back(rgba);
+            }
+            return res;
+        });
+    }
+
+    // сборка атласа для рендерера: screen - ширина, до которой может вырасти окно.
+    // false и текст ошибки, если картинка не прочиталась или атлас не создан
+    bool build(SDL_Renderer *ren, const int screen, string &error)
+    {
+        vector<SDL_Surface *> surfaces = decoded.get();
+        trace_scope trace("build atlas");
+        bool ok = true;
+        for (size_t i = 0; i < surfaces.size() && ok; ++i)
+        {
+            if (!surfaces[i])
+            {
+                error = "can't load texture " + images[i].path;
+                ok = false;
+            }
+        }
+        SDL_RendererInfo info{};
+        SDL_GetRendererInfo(ren, &info);
+        const int max_width = info.max_texture_width ? info.max_texture_width : 4096;
+        const int max_height = info.max_texture_height ? info.max_texture_height : 4096;
+        // картинки больше нужного уменьшаются; не влезающий в видеопамять атлас собирается мельче
+        double target = screen;
+        int width = 0, height = 0;
+        while (ok)
+        {
+            pack(surfaces, target, width, height);
+            if (width <= max_width && height <= max_height)
+                break;
+            target *= 0.75;
+        }
+        SDL_Surface *sheet =
+            ok ? SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32) : nullptr;
+        if (ok && !sheet)
+        {
+            error = "can't create texture atlas";
+            ok = false;
+        }
+        for (size_t i = 0; i < surfaces.size() && ok; ++i)
+        {
+            // прозрачность копируется как есть, а не смешивается с пустым атласом
+            SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+            SDL_BlitScaled(surfaces[i], nullptr, sheet, &rects[i]);
+        }
+        if (ok)
+        {
+            texture_ = SDL_CreateTextureFromSurface(ren, sheet);
+            if (!texture_)
+            {
+                error = "can't create texture atlas";
+                ok = false;
+            }
+        }
+        if (sheet)
+            SDL_FreeSurface(sheet);
+        for (auto s : surfaces)
+        {
+            if (s)
+                SDL_FreeSurface(s);
+        }
+        trace.arg("width", width);
+        trace.arg("height", height);
+        return ok;
+    }
+
+    SDL_Texture *texture() const
+    {
+        return texture_;
+    }
+
+    // прямоугольник картинки number (в порядке start_loading) в атласе
+    const SDL_Rect *rect(const size_t number) const
+    {
+        return &rects[number];
+    }
+
+    void destroy()
+    {
+        // незавершенная загрузка дожидается, поверхности освобождаются
+        if (decoded.valid())
+        {
+            for (auto s : decoded.get())
+            {
+                if (s)
+                    SDL_FreeSurface(s);
+            }
+        }
+        if (texture_)
+            SDL_DestroyTexture(texture_);
+        texture_ = nullptr;
+    }
+
+private:
+    vector<string> paths() const
+    {
+        vector<string> res;
+        for (const auto &image : images)
+            res.push_back(image.path);
+        return res;
+    }
+
+    // раскладка полками: картинки по убыванию высоты, каждая - на первую полку, где хватает места.
+    // ширина атласа - сторона квадрата той же площади, но не уже самой широкой картинки
+    void pack(const vector<SDL_Surface *> &surfaces, const double target, int &width, int &height)
+    {
+        rects.assign(surfaces.size(), SDL_Rect{0, 0, 0, 0});
+        double area = 0;
+        int widest = 0;
+        for (size_t i = 0; i < surfaces.size(); ++i)
+        {
+            const double scale = min(1.0, target * images[i].width_share / surfaces[i]->w);
+            rects[i].w = max(1, int(lround(surfaces[i]->w * scale)));
+            rects[i].h = max(1, int(lround(surfaces[i]->h * scale)));
+            area += double(rects[i].w + padding) * (rects[i].h + padding);
+            widest = max(widest, rects[i].w + padding);
+        }
+        width = max(widest, int(ceil(sqrt(area))));
+        vector<size_t> order(surfaces.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = i;
+        stable_sort(order.begin(), order.end(),
+                    [this](const size_t a, const size_t b) { return rects[a].h > rects[b].h; });
+        struct shelf
+        {
+            int y, height, used;
+        };
+        vector<shelf> shelves;
+        height = 0;
+        for (const size_t i : order)
+        {
+            const int w = rects[i].w + padding, h = rects[i].h + padding;
+            auto it = find_if(shelves.begin(), shelves.end(),
+                              [&](const shelf &s) { return s.height >= h && s.used + w <= width; });
+            if (it == shelves.end())
+            {
+                shelves.push_back({height, h, 0});
+                height += h;
+                it = shelves.end() - 1;
+            }
+            rects[i].x = it->used;
+            rects[i].y = it->y;
+            it->used += w;
+        }
+    }
+
+    static constexpr int padding = 2; // пустые пиксели между картинками: соседние не попадают в выборку
+    vector<atlas_image> images;
+    future<vector<SDL_Surface *>> decoded;
+    vector<SDL_Rect> rects;
+    SDL_Texture *texture_ = nullptr;
+};
@@ -0,0 +1,522 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "../Models/Position.h"
+#include "../Models/Project_path.h"
+
+// SIMD-ядра собираются только на x86 с GCC/Clang, иначе используется скалярная версия
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define CHECKERS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+const int INF = 1e9; // оценка выигранной позиции
+
+// слагаемые оценки позиции, у каждого свой вес в таблице eval_weights
+enum eval_term
+{
+    MAN,         // количество шашек
+    KING,        // количество дамок
+    ADVANCEMENT, // сумма пройденных шашками рядов
+    BACK_RANK,   // шашки, охраняющие свой последний ряд
+    CENTER,      // фигуры на 8 центральных клетках
+    MOBILITY,    // число тихих ходов на соседнюю клетку
+    TEMPO,       // шашки на половине противника
+    RUNAWAY,     // шашки в двух рядах от превращения со свободной клеткой впереди
+    TERMS_COUNT
+};
+
+// плоская таблица весов: оценка стороны = сумма weight[t] * признак[t]
+struct eval_weights
+{
+    double weight[TERMS_COUNT] = {1, 5, 0.05, 0, 0, 0, 0, 0};
+
+    // имена слагаемых в settings.json и weights.json
+    static const char *name(const int term)
+    {
+        static const char *const names[TERMS_COUNT] = {"Man",    "King",     "Advancement", "BackRank",
+                                                       "Center", "Mobility", "Tempo",       "Runaway"};
+        return names[term];
+    }
+
+    // переопределение весов, перечисленных в json по именам
+    void apply(const nlohmann::json &weights)
+    {
+        for (int t = 0; t < TERMS_COUNT; ++t)
+        {
+            weight[t] = weights.value(name(t), weight[t]);
+        }
+    }
+
+    nlohmann::json to_json() const
+    {
+        nlohmann::json weights;
+        for (int t = 0; t < TERMS_COUNT; ++t)
+        {
+            weights[name(t)] = weight[t];
+        }
+        return weights;
+    }
+
+    // загрузка подобранных весов (см. Tools/tuner.cpp), false если файла нет
+    bool load(const string &path)
+    {
+        ifstream fin(path);
+        if (!fin)
+            return false;
+        apply(nlohmann::json::parse(fin));
+        return true;
+    }
+
+    void save(const string &path) const
+    {
+        ofstream fout(path);
+        fout << to_json().dump(4) << endl;
+    }
+};
+
+// пакетная оценка позиций по таблице весов
+class Batch_eval
+{
+public:
+    // kernel: "auto" (выбор по процессору), "avx2", "sse" или "scalar"
+    Batch_eval(const eval_weights &weights = eval_weights(), const string &kernel = "auto") : weights(weights)
+    {
+        select_kernel(kernel);
+    }
+
+    // оценка всех позиций пакета для бота цвета color, out должен вмещать batch.size() значений
+    void score(const pos_batch &batch, const bool color, double *out) const
+    {
+        kernel_fn(batch.w.data(), batch.b.data(), batch.wq.data(), batch.bq.data(), batch.size(), weights, color, out);
+    }
+
+    vector<double> score(const pos_batch &batch, const bool color) const
+    {
+        vector<double> res(batch.size());
+        score(batch, color, res.data());
+        return res;
+    }
+
+    // оценка одной позиции
+    double score(const packed_pos &pos, const bool color) const
+    {
+        double res;
+        score_scalar(&pos.w, &pos.b, &pos.wq, &pos.bq, 1, weights, color, &res);
+        return res;
+    }
+
+    // оценка одной позиции доски G скалярным ядром, специализированным под ее геометрию
+    template <class G>
+    static double score(const basic_packed_pos<G> &pos, const eval_weights &c, const bool color)
+    {
+        typedef board_masks_of<G> M;
+        const typename G::mask empty = ~(pos.w | pos.b | pos.wq | pos.bq) & M::ALL;
+        int fw[TERMS_COUNT], fb[TERMS_COUNT];
+        side_features<G>(pos.w, pos.wq, empty, true, fw);
+        side_features<G>(pos.b, pos.bq, empty, false, fb);
+        double ws = 0, bs = 0;
+        for (int t = 0; t < TERMS_COUNT; ++t)
+        {
+            ws += c.weight[t] * fw[t];
+            bs += c.weight[t] * fb[t];
+        }
+        return combine(ws, bs, fw[MAN] + fw[KING], fb[MAN] + fb[KING], color);
+    }
+
+    // признаки одной стороны доски G, white - направление движения шашек
+    template <class G = geometry8>
+    static void side_features(const typename G::mask men, const typename G::mask kings, const typename G::mask empty,
+                              const bool white, int *f)
+    {
+        typedef board_masks_of<G> M;
+        f[MAN] = popcount(men);
+        f[KING] = popcount(kings);
+        f[ADVANCEMENT] = white ? (G::size - 1) * f[MAN] - row_sum<G>(men) : row_sum<G>(men);
+        f[BACK_RANK] = popcount(men & (white ? M::BOTTOM_ROW : M::TOP_ROW));
+        f[CENTER] = popcount((men | kings) & M::CENTER);
+        f[MOBILITY] = popcount(M::up_left(kings) & empty) + popcount(M::up_right(kings) & empty) +
+                      popcount(M::down_left(kings) & empty) + popcount(M::down_right(kings) & empty);
+        if (white)
+        {
+            f[MOBILITY] += popcount(M::up_left(men) & empty) + popcount(M::up_right(men) & empty);
+            f[TEMPO] = popcount(men & M::TOP_HALF);
+            f[RUNAWAY] = popcount(men & M::TOP_RUNAWAY & (M::down_left(empty) | M::down_right(empty)));
+        }
+        else
+        {
+            f[MOBILITY] += popcount(M::down_left(men) & empty) + popcount(M::down_right(men) & empty);
+            f[TEMPO] = popcount(men & M::BOTTOM_HALF);
+            f[RUNAWAY] = popcount(men & M::BOTTOM_RUNAWAY & (M::up_left(empty) | M::up_right(empty)));
+        }
+    }
+
+    template <class T> static int popcount(T x)
+    {
+        int res = 0;
+        for (; x; x &= x - 1)
+            ++res;
+        return res;
+    }
+
+    // название выбранного ядра
+    const string &kernel() const
+    {
+        return kernel_name;
+    }
+
+    eval_weights weights;
+
+private:
+    typedef void (*kernel_t)(const uint32_t *, const uint32_t *, const uint32_t *, const uint32_t *, size_t,
+                             const eval_weights &, bool, double *);
+
+    void select_kernel(const string &kernel)
+    {
+        kernel_fn = score_scalar;
+        kernel_name = "scalar";
+#ifdef CHECKERS_X86_SIMD
+        __builtin_cpu_init();
+        const bool auto_pick = (kernel == "auto");
+        if ((auto_pick || kernel == "avx2") && __builtin_cpu_supports("avx2"))
+        {
+            kernel_fn = score_avx2;
+            kernel_name = "avx2";
+        }
+        else if ((auto_pick || kernel == "sse") && __builtin_cpu_supports("ssse3"))
+        {
+            kernel_fn = score_sse;
+            kernel_name = "sse";
+        }
+#endif
+    }
+
+    // сумма номеров рядов по всем установленным битам
+    template <class G> static int row_sum(const typename G::mask x)
+    {
+        typedef board_masks_of<G> M;
+        int res = 0;
+        for (int k = 0; k < M::ROW_BITS; ++k)
+            res += popcount(x & M::ROW_BIT[k]) << k;
+        return res;
+    }
+
+    // итоговая оценка: отношение сил бота к силам противника, 0 и INF при отсутствии фигур
+    static double combine(const double ws, const double bs, const int w_count, const int b_count, const bool color)
+    {
+        const int own = color ? b_count : w_count;
+        const int opp = color ? w_count : b_count;
+        if (opp == 0)
+            return INF;
+        if (own == 0)
+            return 0;
+        return color ? max(bs, 1e-9) / max(ws, 1e-9) : max(ws, 1e-9) / max(bs, 1e-9);
+    }
+
+    static void score_scalar(const uint32_t *w, const uint32_t *b, const uint32_t *wq, const uint32_t *bq,
+                             const size_t n, const eval_weights &c, const bool color, double *out)
+    {
+        for (size_t k = 0; k < n; ++k)
+        {
+            const uint32_t empty = ~(w[k] | b[k] | wq[k] | bq[k]);
+            int fw[TERMS_COUNT], fb[TERMS_COUNT];
+            side_features(w[k], wq[k], empty, true, fw);
+            side_features(b[k], bq[k], empty, false, fb);
+            double ws = 0, bs = 0;
+            for (int t = 0; t < TERMS_COUNT; ++t)
+            {
+                ws += c.weight[t] * fw[t];
+                bs += c.weight[t] * fb[t];
+            }
+            out[k] = combine(ws, bs, fw[MAN] + fw[KING], fb[MAN] + fb[KING], color);
+        }
+    }
+
+#ifdef CHECKERS_X86_SIMD
+    // количество единичных бит в каждом 32-битном элементе (по таблице для полубайтов)
+    __attribute__((target("avx2"))) static __m256i popcount_avx2(const __m256i v)
+    {
+        const __m256i lut =
+            _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, //
+                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low = _mm256_set1_epi8(0x0F);
+        const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low));
+        const __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+        const __m256i bytes = _mm256_add_epi8(lo, hi);
+        return _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+    }
+
+    __attribute__((target("avx2"))) static __m256i and_avx2(const __m256i a, const uint32_t m)
+    {
+        return _mm256_and_si256(a, _mm256_set1_epi32(int(m)));
+    }
+
+    // сдвиги по диагоналям, как в board_masks
+    __attribute__((target("avx2"))) static __m256i up_left_avx2(const __m256i x)
+    {
+        typedef board_masks M;
+        return _mm256_or_si256(_mm256_srli_epi32(and_avx2(x, M::EVEN_ROWS), 4),
+                               _mm256_srli_epi32(and_avx2(x, M::ODD_ROWS & ~M::LEFT_COL), 5));
+    }
+    __attribute__((target("avx2"))) static __m256i up_right_avx2(const __m256i x)
+    {
+        typedef board_masks M;
+        return _mm256_or_si256(_mm256_srli_epi32(and_avx2(x, M::EVEN_ROWS & ~M::RIGHT_COL), 3),
+                               _mm256_srli_epi32(and_avx2(x, M::ODD_ROWS), 4));
+    }
+    __attribute__((target("avx2"))) static __m256i down_left_avx2(const __m256i x)
+    {
+        typedef board_masks M;
+        return _mm256_or_si256(_mm256_slli_epi32(and_avx2(x, M::EVEN_ROWS), 4),
+                               _mm256_slli_epi32(and_avx2(x, M::ODD_ROWS & ~M::LEFT_COL), 3));
+    }
+    __attribute__((target("avx2"))) static __m256i down_right_avx2(const __m256i x)
+    {
+        typedef board_masks M;
+        return _mm256_or_si256(_mm256_slli_epi32(and_avx2(x, M::EVEN_ROWS & ~M::RIGHT_COL), 5),
+                               _mm256_slli_epi32(and_avx2(x, M::ODD_ROWS), 4));
+    }
+
+    __attribute__((target("avx2"))) static __m256i row_sum_avx2(const __m256i v)
+    {
+        typedef board_masks M;
+        const __m256i r0 = popcount_avx2(and_avx2(v, M::ROW_BIT[0]));
+        const __m256i r1 = popcount_avx2(and_avx2(v, M::ROW_BIT[1]));
+        const __m256i r2 = popcount_avx2(and_avx2(v, M::ROW_BIT[2]));
+        return _mm256_add_epi32(r0, _mm256_add_epi32(_mm256_slli_epi32(r1, 1), _mm256_slli_epi32(r2, 2)));
+    }
+
+    // признаки одной стороны для 8 позиций, как в side_features
+    __attribute__((target("avx2"))) static void side_features_avx2(const __m256i men, const __m256i kings,
+                                                                   const __m256i empty, const bool white, __m256i *f)
+    {
+        typedef board_masks M;
+        f[MAN] = popcount_avx2(men);
+        f[KING] = popcount_avx2(kings);
+        f[ADVANCEMENT] = white ? _mm256_sub_epi32(_mm256_mullo_epi32(f[MAN], _mm256_set1_epi32(7)), row_sum_avx2(men))
+                               : row_sum_avx2(men);
+        f[BACK_RANK] = popcount_avx2(and_avx2(men, white ? M::BOTTOM_ROW : M::TOP_ROW));
+        f[CENTER] = popcount_avx2(and_avx2(_mm256_or_si256(men, kings), M::CENTER));
+        __m256i mob = _mm256_add_epi32(popcount_avx2(_mm256_and_si256(up_left_avx2(kings), empty)),
+                                       popcount_avx2(_mm256_and_si256(up_right_avx2(kings), empty)));
+        mob = _mm256_add_epi32(mob, popcount_avx2(_mm256_and_si256(down_left_avx2(kings), empty)));
+        mob = _mm256_add_epi32(mob, popcount_avx2(_mm256_and_si256(down_right_avx2(kings), empty)));
+        if (white)
+        {
+            mob = _mm256_add_epi32(mob, popcount_avx2(_mm256_and_si256(up_left_avx2(men), empty)));
+            mob = _mm256_add_epi32(mob, popcount_avx2(_mm256_and_si256(up_right_avx2(men), empty)));
+            f[TEMPO] = popcount_avx2(and_avx2(men, M::TOP_HALF));
+            const __m256i free_ahead = _mm256_or_si256(down_left_avx2(empty), down_right_avx2(empty));
+            f[RUNAWAY] = popcount_avx2(_mm256_and_si256(and_avx2(men, M::TOP_RUNAWAY), free_ahead));
+        }
+        else
+        {
+            mob = _mm256_add_epi32(mob, popcount_avx2(_mm256_and_si256(down_left_avx2(men), empty)));
+            mob = _mm256_add_epi32(mob, popcount_avx2(_mm256_and_si256(down_right_avx2(men), empty)));
+            f[TEMPO] = popcount_avx2(and_avx2(men, M::BOTTOM_HALF));
+            const __m256i free_ahead = _mm256_or_si256(up_left_avx2(empty), up_right_avx2(empty));
+            f[RUNAWAY] = popcount_avx2(_mm256_and_si256(and_avx2(men, M::BOTTOM_RUNAWAY), free_ahead));
+        }
+        f[MOBILITY] = mob;
+    }
+
+    // четыре 32-битных элемента половины half вектора в виде double
+    __attribute__((target("avx2"))) static __m256d half_pd_avx2(const __m256i v, const int half)
+    {
+        return _mm256_cvtepi32_pd(half ? _mm256_extracti128_si256(v, 1) : _mm256_castsi256_si128(v));
+    }
+
+    // итоговая оценка для четырех позиций из половины half
+    __attribute__((target("avx2"))) static __m256d combine_avx2(const __m256i *fw, const __m256i *fb, const int half,
+                                                                const eval_weights &c, const bool color)
+    {
+        __m256d ws = _mm256_setzero_pd(), bs = _mm256_setzero_pd();
+        for (int t = 0; t < TERMS_COUNT; ++t)
+        {
+            const __m256d weight = _mm256_set1_pd(c.weight[t]);
+            ws = _mm256_add_pd(ws, _mm256_mul_pd(weight, half_pd_avx2(fw[t], half)));
+            bs = _mm256_add_pd(bs, _mm256_mul_pd(weight, half_pd_avx2(fb[t], half)));
+        }
+        const __m256d eps = _mm256_set1_pd(1e-9);
+        ws = _mm256_max_pd(ws, eps);
+        bs = _mm256_max_pd(bs, eps);
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d w_none =
+            _mm256_cmp_pd(half_pd_avx2(_mm256_add_epi32(fw[MAN], fw[KING]), half), zero, _CMP_EQ_OQ);
+        const __m256d b_none =
+            _mm256_cmp_pd(half_pd_avx2(_mm256_add_epi32(fb[MAN], fb[KING]), half), zero, _CMP_EQ_OQ);
+        const __m256d own_none = color ? b_none : w_none;
+        const __m256d opp_none = color ? w_none : b_none;
+        __m256d res = color ? _mm256_div_pd(bs, ws) : _mm256_div_pd(ws, bs);
+        res = _mm256_blendv_pd(res, zero, own_none);
+        return _mm256_blendv_pd(res, _mm256_set1_pd(INF), opp_none);
+    }
+
+    __attribute__((target("avx2"))) static void score_avx2(const uint32_t *w, const uint32_t *b, const uint32_t *wq,
+                                                           const uint32_t *bq, const size_t n, const eval_weights &c,
+                                                           const bool color, double *out)
+    {
+        size_t k = 0;
+        for (; k + 8 <= n; k += 8)
+        {
+            const __m256i wv = _mm256_loadu_si256((const __m256i *)(w + k));
+            const __m256i bv = _mm256_loadu_si256((const __m256i *)(b + k));
+            const __m256i wqv = _mm256_loadu_si256((const __m256i *)(wq + k));
+            const __m256i bqv = _mm256_loadu_si256((const __m256i *)(bq + k));
+            const __m256i all = _mm256_or_si256(_mm256_or_si256(wv, bv), _mm256_or_si256(wqv, bqv));
+            const __m256i empty = _mm256_xor_si256(all, _mm256_set1_epi32(-1));
+            __m256i fw[TERMS_COUNT], fb[TERMS_COUNT];
+            side_features_avx2(wv, wqv, empty, true, fw);
+            side_features_avx2(bv, bqv, empty, false, fb);
+            _mm256_storeu_pd(out + k, combine_avx2(fw, fb, 0, c, color));
+            _mm256_storeu_pd(out + k + 4, combine_avx2(fw, fb, 1, c, color));
+        }
+        score_scalar(w + k, b + k, wq + k, bq + k, n - k, c, color, out + k);
+    }
+
+    __attribute__((target("ssse3"))) static __m128i popcount_sse(const __m128i v)
+    {
+        const __m128i lut = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m128i low = _mm_set1_epi8(0x0F);
+        const __m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(v, low));
+        const __m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(v, 4), low));
+        const __m128i bytes = _mm_add_epi8(lo, hi);
+        return _mm_madd_epi16(_mm_maddubs_epi16(bytes, _mm_set1_epi8(1)), _mm_set1_epi16(1));
+    }
+
+    __attribute__((target("ssse3"))) static __m128i and_sse(const __m128i a, const uint32_t m)
+    {
+        return _mm_and_si128(a, _mm_set1_epi32(int(m)));
+    }
+
+    __attribute__((target("ssse3"))) static __m128i up_left_sse(const __m128i x)
+    {
+        typedef board_masks M;
+        return _mm_or_si128(_mm_srli_epi32(and_sse(x, M::EVEN_ROWS), 4),
+                            _mm_srli_epi32(and_sse(x, M::ODD_ROWS & ~M::LEFT_COL), 5));
+    }
+    __attribute__((target("ssse3"))) static __m128i up_right_sse(const __m128i x)
+    {
+        typedef board_masks M;
+        return _mm_or_si128(_mm_srli_epi32(and_sse(x, M::EVEN_ROWS & ~M::RIGHT_COL), 3),
+                            _mm_srli_epi32(and_sse(x, M::ODD_ROWS), 4));
+    }
+    __attribute__((target("ssse3"))) static __m128i down_left_sse(const __m128i x)
+    {
+        typedef board_masks M;
+        return _mm_or_si128(_mm_slli_epi32(and_sse(x, M::EVEN_ROWS), 4),
+                            _mm_slli_epi32(and_sse(x, M::ODD_ROWS & ~M::LEFT_COL), 3));
+    }
+    __attribute__((target("ssse3"))) static __m128i down_right_sse(const __m128i x)
+    {
+        typedef board_masks M;
+        return _mm_or_si128(_mm_slli_epi32(and_sse(x, M::EVEN_ROWS & ~M::RIGHT_COL), 5),
+                            _mm_slli_epi32(and_sse(x, M::ODD_ROWS), 4));
+    }
+
+    __attribute__((target("ssse3"))) static __m128i row_sum_sse(const __m128i v)
+    {
+        typedef board_masks M;
+        const __m128i r0 = popcount_sse(and_sse(v, M::ROW_BIT[0]));
+        const __m128i r1 = popcount_sse(and_sse(v, M::ROW_BIT[1]));
+        const __m128i r2 = popcount_sse(and_sse(v, M::ROW_BIT[2]));
+        return _mm_add_epi32(r0, _mm_add_epi32(_mm_slli_epi32(r1, 1), _mm_slli_epi32(r2, 2)));
+    }
+
+    // признаки одной стороны для 4 позиций, как в side_features
+    __attribute__((target("ssse3"))) static void side_features_sse(const __m128i men, const __m128i kings,
+                                                                   const __m128i empty, const bool white, __m128i *f)
+    {
+        typedef board_masks M;
+        f[MAN] = popcount_sse(men);
+        f[KING] = popcount_sse(kings);
+        // умножение на 7 без SSE4.1: 8x - x
+        f[ADVANCEMENT] = white ? _mm_sub_epi32(_mm_sub_epi32(_mm_slli_epi32(f[MAN], 3), f[MAN]), row_sum_sse(men))
+                               : row_sum_sse(men);
+        f[BACK_RANK] = popcount_sse(and_sse(men, white ? M::BOTTOM_ROW : M::TOP_ROW));
+        f[CENTER] = popcount_sse(and_sse(_mm_or_si128(men, kings), M::CENTER));
+        __m128i mob = _mm_add_epi32(popcount_sse(_mm_and_si128(up_left_sse(kings), empty)),
+                                    popcount_sse(_mm_and_si128(up_right_sse(kings), empty)));
+        mob = _mm_add_epi32(mob, popcount_sse(_mm_and_si128(down_left_sse(kings), empty)));
+        mob = _mm_add_epi32(mob, popcount_sse(_mm_and_si128(down_right_sse(kings), empty)));
+        if (white)
+        {
+            mob = _mm_add_epi32(mob, popcount_sse(_mm_and_si128(up_left_sse(men), empty)));
+            mob = _mm_add_epi32(mob, popcount_sse(_mm_and_si128(up_right_sse(men), empty)));
+            f[TEMPO] = popcount_sse(and_sse(men, M::TOP_HALF));
+            const __m128i free_ahead = _mm_or_si128(down_left_sse(empty), down_right_sse(empty));
+            f[RUNAWAY] = popcount_sse(_mm_and_si128(and_sse(men, M::TOP_RUNAWAY), free_ahead));
+        }
+        else
+        {
+            mob = _mm_add_epi32(mob, popcount_sse(_mm_and_si128(down_left_sse(men), empty)));
+            mob = _mm_add_epi32(mob, popcount_sse(_mm_and_si128(down_right_sse(men), empty)));
+            f[TEMPO] = popcount_sse(and_sse(men, M::BOTTOM_HALF));
+            const __m128i free_ahead = _mm_or_si128(up_left_sse(empty), up_right_sse(empty));
+            f[RUNAWAY] = popcount_sse(_mm_and_si128(and_sse(men, M::BOTTOM_RUNAWAY), free_ahead));
+        }
+        f[MOBILITY] = mob;
+    }
+
+    // два 32-битных элемента половины half вектора в виде double
+    __attribute__((target("ssse3"))) static __m128d half_pd_sse(const __m128i v, const int half)
+    {
+        return _mm_cvtepi32_pd(half ? _mm_srli_si128(v, 8) : v);
+    }
+
+    // итоговая оценка для двух позиций из половины half
+    __attribute__((target("ssse3"))) static __m128d combine_sse(const __m128i *fw, const __m128i *fb, const int half,
+                                                                const eval_weights &c, const bool color)
+    {
+        __m128d ws = _mm_setzero_pd(), bs = _mm_setzero_pd();
+        for (int t = 0; t < TERMS_COUNT; ++t)
+        {
+            const __m128d weight = _mm_set1_pd(c.weight[t]);
+            ws = _mm_add_pd(ws, _mm_mul_pd(weight, half_pd_sse(fw[t], half)));
+            bs = _mm_add_pd(bs, _mm_mul_pd(weight, half_pd_sse(fb[t], half)));
+        }
+        const __m128d eps = _mm_set1_pd(1e-9);
+        ws = _mm_max_pd(ws, eps);
+        bs = _mm_max_pd(bs, eps);
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d w_none = _mm_cmpeq_pd(half_pd_sse(_mm_add_epi32(fw[MAN], fw[KING]), half), zero);
+        const __m128d b_none = _mm_cmpeq_pd(half_pd_sse(_mm_add_epi32(fb[MAN], fb[KING]), half), zero);
+        const __m128d own_none = color ? b_none : w_none;
+        const __m128d opp_none = color ? w_none : b_none;
+        __m128d res = color ? _mm_div_pd(bs, ws) : _mm_div_pd(ws, bs);
+        res = _mm_andnot_pd(own_none, res);
+        return _mm_or_pd(_mm_andnot_pd(opp_none, res), _mm_and_pd(opp_none, _mm_set1_pd(INF)));
+    }
+
+    __attribute__((target("ssse3"))) static void score_sse(const uint32_t *w, const uint32_t *b, const uint32_t *wq,
+                                                           const uint32_t *bq, const size_t n, const eval_weights &c,
+                                                           const bool color, double *out)
+    {
+        size_t k = 0;
+        for (; k + 4 <= n; k += 4)
+        {
+            const __m128i wv = _mm_loadu_si128((const __m128i *)(w + k));
+            const __m128i bv = _mm_loadu_si128((const __m128i *)(b + k));
+            const __m128i wqv = _mm_loadu_si128((const __m128i *)(wq + k));
+            const __m128i bqv = _mm_loadu_si128((const __m128i *)(bq + k));
+            const __m128i all = _mm_or_si128(_mm_or_si128(wv, bv), _mm_or_si128(wqv, bqv));
+            const __m128i empty = _mm_xor_si128(all, _mm_set1_epi32(-1));
+            __m128i fw[TERMS_COUNT], fb[TERMS_COUNT];
+            side_features_sse(wv, wqv, empty, true, fw);
+            side_features_sse(bv, bqv, empty, false, fb);
+            _mm_storeu_pd(out + k, combine_sse(fw, fb, 0, c, color));
+            _mm_storeu_pd(out + k + 2, combine_sse(fw, fb, 1, c, color));
+        }
+        score_scalar(w + k, b + k, wq + k, bq + k, n - k, c, color, out + k);
+    }
+#endif
+
+    kernel_t kernel_fn;
+    string kernel_name;
+};
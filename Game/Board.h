@@ -3,22 +3,20 @@
 #include <fstream>
 #include <vector>
 
+#include "../Models/Geometry.h"
 #include "../Models/Move.h"
 #include "../Models/Project_path.h"
-
-#ifdef __APPLE__
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#else
-#include <SDL.h>
-#include <SDL_image.h>
-#endif
+#include "Atlas.h"
+#include "Trace.h"
 
 using namespace std;
 
 class Board
 {
 public:
+    static constexpr int N = geometry8::size; // клеток в ряду доски
+    static constexpr int grid = N + 2;        // клеток сетки окна: доска и поля с кнопками по краям
+
     Board() = default;
     Board(const unsigned int W, const unsigned int H) : W(W), H(H)
     {
@@ -27,17 +25,34 @@ public:
     // инициализация и отрисовка начального состояния доски
     int start_draw()
     {
-        // инициализация SDL
-        if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
+        // картинки декодируются в фоне, пока создаются окно и рендерер. порядок - как в texture_part,
+        // доли - ширина, с которой картинка рисуется в rerender
+        const double piece_share = 5.0 / (6 * grid);
+        atlas.start_loading({{board_path, 1},
+                             {piece_white_path, piece_share},
+                             {piece_black_path, piece_share},
+                             {queen_white_path, piece_share},
+                             {queen_black_path, piece_share},
+                             {back_path, 1.0 / 15},
+                             {replay_path, 1.0 / 15},
+                             {white_path, 3.0 / 5},
+                             {black_path, 3.0 / 5},
+                             {draw_path, 3.0 / 5}});
+        // инициализация SDL: только видео и события, звук, джойстики и отдача игре не нужны
         {
-            print_exception("SDL_Init can't init SDL2 lib");
-            return 1;
+            trace_scope trace("sdl init");
+            if (SDL_Init(SDL_INIT_VIDEO) != 0)
+            {
+                print_exception("SDL_Init can't init SDL2 lib");
+                return 1;
+            }
         }
+        SDL_DisplayMode dm;
+        const bool have_display = SDL_GetDesktopDisplayMode(0, &dm) == 0;
         // автоматическое определение размера окна
         if (W == 0 || H == 0)
         {
-            SDL_DisplayMode dm;
-            if (SDL_GetDesktopDisplayMode(0, &dm))
+            if (!have_display)
             {
                 print_exception("SDL_GetDesktopDisplayMode can't get desctop display mode");
                 return 1;
@@ -47,32 +62,29 @@ public:
             H = W;
         }
         // создание окна и рендерера
-        win = SDL_CreateWindow("Checkers", 0, H / 30, W, H, SDL_WINDOW_RESIZABLE);
-        if (win == nullptr)
         {
-            print_exception("SDL_CreateWindow can't create window");
-            return 1;
-        }
-        ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-        if (ren == nullptr)
-        {
-            print_exception("SDL_CreateRenderer can't create renderer");
-            return 1;
+            trace_scope trace("window");
+            win = SDL_CreateWindow("Checkers", 0, H / 30, W, H, SDL_WINDOW_RESIZABLE);
+            if (win == nullptr)
+            {
+                print_exception("SDL_CreateWindow can't create window");
+                return 1;
+            }
+            ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+            if (ren == nullptr)
+            {
+                print_exception("SDL_CreateRenderer can't create renderer");
+                return 1;
+            }
         }
-        // загрузка текстур
-        board = IMG_LoadTexture(ren, board_path.c_str());
-        w_piece = IMG_LoadTexture(ren, piece_white_path.c_str());
-        b_piece = IMG_LoadTexture(ren, piece_black_path.c_str());
-        w_queen = IMG_LoadTexture(ren, queen_white_path.c_str());
-        b_queen = IMG_LoadTexture(ren, queen_black_path.c_str());
-        back = IMG_LoadTexture(ren, back_path.c_str());
-        replay = IMG_LoadTexture(ren, replay_path.c_str());
-        if (!board || !w_piece || !b_piece || !w_queen || !b_queen || !back || !replay)
+        SDL_GetRendererOutputSize(ren, &W, &H);
+        // текстуры - одна загрузка атласа; картинки уменьшаются до окна, растянутого на весь экран
+        string error;
+        if (!atlas.build(ren, max({W, H, have_display ? max(dm.w, dm.h) : 0}), error))
         {
-            print_exception("IMG_LoadTexture can't load main textures from " + textures_path);
+            print_exception(error + " from " + textures_path);
             return 1;
         }
-        SDL_GetRendererOutputSize(ren, &W, &H);
         // создание начальной позиции
         make_start_mtx();
         rerender();
@@ -88,6 +100,7 @@ public:
         make_start_mtx();
         clear_active();
         clear_highlight();
+        clear_hints();
     }
 
     // перемещение фигуры по заданному ходу
@@ -113,7 +126,7 @@ public:
             throw runtime_error("begin position is empty, can't move");
         }
         // превращение в дамку при достижении края
-        if ((mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == 7))
+        if ((mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == N - 1))
             mtx[i][j] += 2;
         mtx[i2][j2] = mtx[i][j];
         drop_piece(i, j);
@@ -154,9 +167,9 @@ public:
     // отмена подсветки клеток
     void clear_highlight()
     {
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < N; ++i)
         {
-            is_highlighted_[i].assign(8, 0);
+            is_highlighted_[i].assign(N, 0);
         }
         rerender();
     }
@@ -177,6 +190,21 @@ public:
         rerender();
     }
 
+    // подсказка: серии лучших ходов стрелками, первая - лучший ход
+    void set_hints(vector<vector<move_pos>> series)
+    {
+        hints = move(series);
+        rerender();
+    }
+
+    void clear_hints()
+    {
+        if (hints.empty())
+            return;
+        hints.clear();
+        rerender();
+    }
+
     bool is_highlighted(const POS_T x, const POS_T y)
     {
         return is_highlighted_[x][y];
@@ -210,13 +238,7 @@ public:
 
     void quit()
     {
-        SDL_DestroyTexture(board);
-        SDL_DestroyTexture(w_piece);
-        SDL_DestroyTexture(b_piece);
-        SDL_DestroyTexture(w_queen);
-        SDL_DestroyTexture(b_queen);
-        SDL_DestroyTexture(back);
-        SDL_DestroyTexture(replay);
+        atlas.destroy();
         SDL_DestroyRenderer(ren);
         SDL_DestroyWindow(win);
         SDL_Quit();
@@ -238,16 +260,16 @@ private:
     // function to make start matrix
     void make_start_mtx()
     {
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < N; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < N; ++j)
             {
                 mtx[i][j] = 0;
                 // черные фигуры в верхних рядах на черных клетках
-                if (i < 3 && (i + j) % 2 == 1)
+                if (i < geometry8::start_rows && (i + j) % 2 == 1)
                     mtx[i][j] = 2;
                 // белые фигуры в нижних рядах на черных клетках
-                if (i > 4 && (i + j) % 2 == 1)
+                if (i >= N - geometry8::start_rows && (i + j) % 2 == 1)
                     mtx[i][j] = 1;
             }
         }
@@ -257,33 +279,26 @@ private:
     // function that re-draw all the textures
     void rerender()
     {
+        trace_scope trace("render");
         // отрисовка доски
         SDL_RenderClear(ren);
-        SDL_RenderCopy(ren, board, NULL, NULL);
+        SDL_Texture *sheet = atlas.texture();
+        SDL_RenderCopy(ren, sheet, atlas.rect(BOARD), NULL);
 
         // отрисовка фигур
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < N; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < N; ++j)
             {
                 if (!mtx[i][j])
                     continue;
-                int wpos = W * (j + 1) / 10 + W / 120;
-                int hpos = H * (i + 1) / 10 + H / 120;
-                SDL_Rect rect{wpos, hpos, W / 12, H / 12};
-
-                // выбор текстуры в зависимости от типа фигуры
-                SDL_Texture *piece_texture;
-                if (mtx[i][j] == 1)
-                    piece_texture = w_piece;
-                else if (mtx[i][j] == 2)
-                    piece_texture = b_piece;
-                else if (mtx[i][j] == 3)
-                    piece_texture = w_queen;
-                else
-                    piece_texture = b_queen;
-
-                SDL_RenderCopy(ren, piece_texture, NULL, &rect);
+                // фигура - 5/6 клетки по центру клетки
+                int wpos = W * (j + 1) / grid + W / (12 * grid);
+                int hpos = H * (i + 1) / grid + H / (12 * grid);
+                SDL_Rect rect{wpos, hpos, W * 5 / (6 * grid), H * 5 / (6 * grid)};
+
+                // выбор текстуры в зависимости от типа фигуры: части атласа идут в порядке типов
+                SDL_RenderCopy(ren, sheet, atlas.rect(W_PIECE + mtx[i][j] - 1), &rect);
             }
         }
 
@@ -291,14 +306,14 @@ private:
         SDL_SetRenderDrawColor(ren, 0, 255, 0, 0);
         const double scale = 2.5;
         SDL_RenderSetScale(ren, scale, scale);
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < N; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < N; ++j)
             {
                 if (!is_highlighted_[i][j])
                     continue;
-                SDL_Rect cell{int(W * (j + 1) / 10 / scale), int(H * (i + 1) / 10 / scale), int(W / 10 / scale),
-                              int(H / 10 / scale)};
+                SDL_Rect cell{int(W * (j + 1) / grid / scale), int(H * (i + 1) / grid / scale),
+                              int(W / grid / scale), int(H / grid / scale)};
                 SDL_RenderDrawRect(ren, &cell);
             }
         }
@@ -307,39 +322,53 @@ private:
         if (active_x != -1)
         {
             SDL_SetRenderDrawColor(ren, 255, 0, 0, 0);
-            SDL_Rect active_cell{int(W * (active_y + 1) / 10 / scale), int(H * (active_x + 1) / 10 / scale),
-                                 int(W / 10 / scale), int(H / 10 / scale)};
+            SDL_Rect active_cell{int(W * (active_y + 1) / grid / scale), int(H * (active_x + 1) / grid / scale),
+                                 int(W / grid / scale), int(H / grid / scale)};
             SDL_RenderDrawRect(ren, &active_cell);
         }
+
+        // подсказки: лучший ход синим, остальные бледнее по порядку; конец каждого взятия отмечен квадратом
+        for (size_t k = hints.size(); k-- > 0;)
+        {
+            const Uint8 fade = Uint8(min<size_t>(k * 60, 180));
+            SDL_SetRenderDrawColor(ren, fade, Uint8(90 + fade / 2), 255, 0);
+            for (const auto &turn : hints[k])
+            {
+                const int x1 = int((W * (turn.y + 1) / grid + W / (2 * grid)) / scale);
+                const int y1 = int((H * (turn.x + 1) / grid + H / (2 * grid)) / scale);
+                const int x2 = int((W * (turn.y2 + 1) / grid + W / (2 * grid)) / scale);
+                const int y2 = int((H * (turn.x2 + 1) / grid + H / (2 * grid)) / scale);
+                SDL_RenderDrawLine(ren, x1, y1, x2, y2);
+                const int mark = max(2, int(W / (10 * grid) / scale));
+                SDL_Rect end{x2 - mark / 2, y2 - mark / 2, mark, mark};
+                SDL_RenderFillRect(ren, &end);
+            }
+        }
         SDL_RenderSetScale(ren, 1, 1);
 
         // отрисовка кнопок управления
         SDL_Rect rect_left{W / 40, H / 40, W / 15, H / 15};
-        SDL_RenderCopy(ren, back, NULL, &rect_left);
+        SDL_RenderCopy(ren, sheet, atlas.rect(BACK), &rect_left);
         SDL_Rect replay_rect{W * 109 / 120, H / 40, W / 15, H / 15};
-        SDL_RenderCopy(ren, replay, NULL, &replay_rect);
+        SDL_RenderCopy(ren, sheet, atlas.rect(REPLAY), &replay_rect);
 
         // отрисовка результата игры
         if (game_results != -1)
         {
-            string result_path = draw_path;
+            texture_part result = DRAW_RESULT;
             if (game_results == 1)
-                result_path = white_path;
+                result = WHITE_WINS;
             else if (game_results == 2)
-                result_path = black_path;
-            SDL_Texture *result_texture = IMG_LoadTexture(ren, result_path.c_str());
-            if (result_texture == nullptr)
-            {
-                print_exception("IMG_LoadTexture can't load game result picture from " + result_path);
-                return;
-            }
+                result = BLACK_WINS;
             SDL_Rect res_rect{W / 5, H * 3 / 10, W * 3 / 5, H * 2 / 5};
-            SDL_RenderCopy(ren, result_texture, NULL, &res_rect);
-            SDL_DestroyTexture(result_texture);
+            SDL_RenderCopy(ren, sheet, atlas.rect(result), &res_rect);
         }
 
         SDL_RenderPresent(ren);
-        SDL_Delay(10);
+        {
+            trace_scope delay_trace("render delay");
+            SDL_Delay(10);
+        }
         SDL_Event windowEvent;
         SDL_PollEvent(&windowEvent);
     }
@@ -359,14 +388,21 @@ public:
 private:
     SDL_Window *win = nullptr;   // окно SDL
     SDL_Renderer *ren = nullptr; // рендерер SDL
-    // текстуры для отрисовки
-    SDL_Texture *board = nullptr;   // доска
-    SDL_Texture *w_piece = nullptr; // белая шашка
-    SDL_Texture *b_piece = nullptr; // черная шашка
-    SDL_Texture *w_queen = nullptr; // белая дамка
-    SDL_Texture *b_queen = nullptr; // черная дамка
-    SDL_Texture *back = nullptr;    // кнопка "назад"
-    SDL_Texture *replay = nullptr;  // кнопка "повтор"
+    // части атласа текстур
+    enum texture_part : size_t
+    {
+        BOARD,      // доска
+        W_PIECE,    // белая шашка
+        B_PIECE,    // черная шашка
+        W_QUEEN,    // белая дамка
+        B_QUEEN,    // черная дамка
+        BACK,       // кнопка "назад"
+        REPLAY,     // кнопка "повтор"
+        WHITE_WINS, // результаты игры
+        BLACK_WINS,
+        DRAW_RESULT
+    };
+    Atlas atlas; // все текстуры одной текстурой
     // пути к файлам текстур
     const string textures_path = project_path + "Textures/";
     const string board_path = textures_path + "board.png";
@@ -383,8 +419,9 @@ private:
     int active_x = -1, active_y = -1;
     int game_results = -1; // результат игры (-1 = игра идет)
     // матрица подсветки возможных ходов
-    vector<vector<bool>> is_highlighted_ = vector<vector<bool>>(8, vector<bool>(8, 0));
+    vector<vector<bool>> is_highlighted_ = vector<vector<bool>>(N, vector<bool>(N, 0));
+    vector<vector<move_pos>> hints; // серии ходов подсказки, первая - лучшая
     // матрица игрового поля: 1-белая шашка, 2-черная шашка, 3-белая дамка, 4-черная дамка
-    vector<vector<POS_T>> mtx = vector<vector<POS_T>>(8, vector<POS_T>(8, 0));
+    vector<vector<POS_T>> mtx = vector<vector<POS_T>>(N, vector<POS_T>(N, 0));
     vector<int> history_beat_series; // история серий боя для каждого хода
 };
@@ -1,10 +1,244 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <fstream>
+#include <functional>
+#include <memory>
 #include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <thread>
 using json = nlohmann::json;
+using namespace std;
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
 
 #include "../Models/Project_path.h"
 
+// уровень оптимизации поиска: O0 - полный перебор, O1 - отсечения и упорядочивание ходов
+enum class optimization_level
+{
+  O0,
+  O1,
+  O2
+};
+
+// настройки бота одного цвета
+struct bot_settings
+{
+  bool is_bot = false;        // этим цветом играет бот
+  size_t level = 0;           // уровень сложности (глубина поиска)
+  json eval = json::object(); // тип ("Type") и веса слагаемых оценки
+};
+
+// выборочный поиск в find_best_turns_rec: каждое сокращение и отсечение включается отдельно.
+// глубины - оставшиеся полуходы до горизонта, запасы - во сколько раз (оценка - отношение сил)
+struct selective_settings
+{
+  bool lmr = false;              // сокращение глубины поздних спокойных ходов (late move reductions)
+  size_t lmr_depth = 3;          // минимальная оставшаяся глубина для сокращения
+  size_t lmr_moves = 3;          // первые ходы узла всегда ищутся на полную глубину
+  size_t lmr_reduction = 1;      // сокращение в полуходах
+  bool probcut = false;          // отсечение по неглубокому поиску узла (ProbCut)
+  size_t probcut_depth = 6;      // минимальная оставшаяся глубина для неглубокого поиска
+  size_t probcut_reduction = 4;  // на сколько полуходов неглубокий поиск короче
+  double probcut_margin = 1.1;   // запас оценки неглубокого поиска за границей окна
+  bool futility = false;         // отсечение безнадежных узлов у горизонта по статической оценке
+  size_t futility_depth = 1;     // максимальная оставшаяся глубина
+  double futility_margin = 1.25; // запас статической оценки на полуход
+};
+
+// настройки из settings.json, разобранные и проверенные один раз при загрузке
+struct settings
+{
+  unsigned width = 0;                                        // ширина окна, ноль значит автоматически
+  unsigned height = 0;                                       // высота окна, ноль значит автоматически
+  bot_settings bot[2];                                       // белый [0] и черный [1] боты
+  string scoring_type = "NumberAndPotential";                // тип оценки позиции по умолчанию
+  unsigned delay_ms = 0;                                     // задержка хода бота в мс
+  bool no_random = false;                                    // отключить случайность в ходах
+  optimization_level optimization = optimization_level::O1; // уровень оптимизации
+  size_t quiescence_nodes = 100000;                          // лимит узлов продолжения взятий за горизонтом
+  size_t tt_size_mb = 16;                                    // размер таблицы транспозиций в МБ
+  string tt_file;                                            // файл таблицы между запусками ("" - не сохранять)
+  unsigned tt_file_depth = 4;                                // минимальная оставшаяся глубина записей файла
+  size_t threads = 1;                                        // потоки поиска корня
+  bool deterministic = false;                                // результат поиска не зависит от потоков и времени
+  size_t nodes_per_ms = 500;                                 // перевод movetime в лимит узлов (deterministic)
+  size_t max_memory_mb = 0;                                  // лимит памяти поиска в МБ (0 - без лимита)
+  selective_settings selective;                              // сокращения и отсечения выборочного поиска
+  unsigned max_turns = 120;                                  // максимальное количество ходов в игре
+  unsigned repetition_draw = 3;                              // ничья при таком повторении позиции (0 - нет)
+  unsigned no_progress_moves = 15;                           // ничья после стольких ходов без продвижения (0 - нет)
+  bool record_games = false;                                 // записывать партии в games.bin
+  bool watch_settings = true;                                // применять изменения settings.json без перезапуска
+  string trace_file;                                         // файл временной шкалы Chrome trace ("" - выключена)
+  unsigned annotate_depth = 0;                               // глубина оценки ходов сыгранной партии (0 - нет)
+  unsigned hint_lines = 0;                                   // лучших ходов в подсказке игроку (0 - без подсказки)
+  unsigned hint_depth = 6;                                   // глубина поиска подсказки
+
+  // тип оценки бота цвета color: "Type" из его настроек или общий BotScoringType
+  string eval_type(const bool color) const
+  {
+    return bot[color].eval.value("Type", scoring_type);
+  }
+
+  // разбор json; отсутствующие значения остаются по умолчанию, неверные - runtime_error с именем настройки
+  static settings parse(const json &root)
+  {
+    settings s;
+    const json &window = section(root, "WindowSize");
+    read_uint(window, "WindowSize", "Width", s.width);
+    read_uint(window, "WindowSize", "Hight", s.height);
+
+    const json &bot = section(root, "Bot");
+    const char *colors[2] = {"White", "Black"};
+    for (int c = 0; c < 2; ++c)
+    {
+      read_bool(bot, "Bot", string("Is") + colors[c] + "Bot", s.bot[c].is_bot);
+      read_uint(bot, "Bot", string(colors[c]) + "BotLevel", s.bot[c].level);
+      read_eval(bot, string(colors[c]) + "BotEval", s.bot[c].eval);
+    }
+    read_string(bot, "Bot", "BotScoringType", s.scoring_type);
+    for (int c = 0; c < 2; ++c)
+      check_weights_file(s.eval_type(c));
+    read_uint(bot, "Bot", "BotDelayMS", s.delay_ms);
+    read_bool(bot, "Bot", "NoRandom", s.no_random);
+    string optimization = "O1";
+    read_string(bot, "Bot", "Optimization", optimization);
+    if (optimization == "O0")
+      s.optimization = optimization_level::O0;
+    else if (optimization == "O1")
+      s.optimization = optimization_level::O1;
+    else if (optimization == "O2")
+      s.optimization = optimization_level::O2;
+    else
+      throw runtime_error("settings.json: Bot.Optimization must be \"O0\", \"O1\" or \"O2\", not \"" + optimization +
+                          "\"");
+    read_uint(bot, "Bot", "QuiescenceNodes", s.quiescence_nodes);
+    read_uint(bot, "Bot", "TTSizeMB", s.tt_size_mb);
+    read_string(bot, "Bot", "TTFile", s.tt_file);
+    read_uint(bot, "Bot", "TTFileDepth", s.tt_file_depth);
+    read_uint(bot, "Bot", "Threads", s.threads);
+    read_bool(bot, "Bot", "Deterministic", s.deterministic);
+    read_uint(bot, "Bot", "NodesPerMS", s.nodes_per_ms);
+    read_uint(bot, "Bot", "MaxMemoryMB", s.max_memory_mb);
+    if (s.max_memory_mb && s.tt_size_mb >= s.max_memory_mb)
+      throw runtime_error("settings.json: Bot.TTSizeMB must be less than Bot.MaxMemoryMB");
+    selective_settings &sel = s.selective;
+    read_bool(bot, "Bot", "LMR", sel.lmr);
+    read_uint(bot, "Bot", "LMRDepth", sel.lmr_depth);
+    read_uint(bot, "Bot", "LMRMoves", sel.lmr_moves);
+    read_uint(bot, "Bot", "LMRReduction", sel.lmr_reduction);
+    read_bool(bot, "Bot", "ProbCut", sel.probcut);
+    read_uint(bot, "Bot", "ProbCutDepth", sel.probcut_depth);
+    read_uint(bot, "Bot", "ProbCutReduction", sel.probcut_reduction);
+    read_margin(bot, "ProbCutMargin", sel.probcut_margin);
+    read_bool(bot, "Bot", "Futility", sel.futility);
+    read_uint(bot, "Bot", "FutilityDepth", sel.futility_depth);
+    read_margin(bot, "FutilityMargin", sel.futility_margin);
+    // неглубокий поиск должен быть короче узла и не доходить до горизонта
+    if (sel.probcut && (sel.probcut_reduction == 0 || sel.probcut_reduction >= sel.probcut_depth))
+      throw runtime_error("settings.json: Bot.ProbCutReduction must be positive and less than Bot.ProbCutDepth");
+
+    const json &game = section(root, "Game");
+    read_uint(game, "Game", "MaxNumTurns", s.max_turns);
+    read_uint(game, "Game", "RepetitionDraw", s.repetition_draw);
+    read_uint(game, "Game", "NoProgressMoves", s.no_progress_moves);
+    read_bool(game, "Game", "RecordGames", s.record_games);
+    read_bool(game, "Game", "WatchSettings", s.watch_settings);
+    read_string(game, "Game", "TraceFile", s.trace_file);
+    read_uint(game, "Game", "AnnotateDepth", s.annotate_depth);
+    read_uint(game, "Game", "HintLines", s.hint_lines);
+    read_uint(game, "Game", "HintDepth", s.hint_depth);
+    return s;
+  }
+
+private:
+  static const json &section(const json &root, const string &name)
+  {
+    static const json empty = json::object();
+    if (!root.contains(name))
+      return empty;
+    if (!root[name].is_object())
+      throw runtime_error("settings.json: " + name + " must be an object");
+    return root[name];
+  }
+
+  static void read_bool(const json &dir, const string &dir_name, const string &name, bool &value)
+  {
+    if (!dir.contains(name))
+      return;
+    if (!dir[name].is_boolean())
+      throw runtime_error("settings.json: " + dir_name + "." + name + " must be true or false");
+    value = dir[name].get<bool>();
+  }
+
+  template <class T> static void read_uint(const json &dir, const string &dir_name, const string &name, T &value)
+  {
+    if (!dir.contains(name))
+      return;
+    if (!dir[name].is_number_unsigned())
+      throw runtime_error("settings.json: " + dir_name + "." + name + " must be a non-negative integer");
+    value = dir[name].get<T>();
+  }
+
+  static void read_string(const json &dir, const string &dir_name, const string &name, string &value)
+  {
+    if (!dir.contains(name))
+      return;
+    if (!dir[name].is_string())
+      throw runtime_error("settings.json: " + dir_name + "." + name + " must be a string");
+    value = dir[name].get<string>();
+  }
+
+  // запас оценки: число не меньше 1 (во сколько раз)
+  static void read_margin(const json &bot, const string &name, double &value)
+  {
+    if (!bot.contains(name))
+      return;
+    if (!bot[name].is_number() || bot[name].get<double>() < 1)
+      throw runtime_error("settings.json: Bot." + name + " must be a number not less than 1");
+    value = bot[name].get<double>();
+  }
+
+  // оценке "Tuned" нужен читаемый weights.json: без него она молча играла бы с весами по умолчанию
+  static void check_weights_file(const string &type)
+  {
+    if (type != "Tuned")
+      return;
+    const string path = project_path + "weights.json";
+    ifstream fin(path);
+    if (!fin || !json::accept(fin))
+      throw runtime_error("settings.json: BotScoringType \"Tuned\" needs weights.json from Tools/tuner, can't read " +
+                          path);
+  }
+
+  // настройки оценки бота: объект с необязательной строкой "Type" и числовыми весами слагаемых
+  static void read_eval(const json &bot, const string &name, json &value)
+  {
+    value = json::object();
+    if (!bot.contains(name))
+      return;
+    const json &eval = bot[name];
+    if (!eval.is_object())
+      throw runtime_error("settings.json: Bot." + name + " must be an object");
+    for (auto it = eval.begin(); it != eval.end(); ++it)
+    {
+      if (it.key() == "Type" ? !it.value().is_string() : !it.value().is_number())
+        throw runtime_error("settings.json: Bot." + name + "." + it.key() + " must be a " +
+                            (it.key() == "Type" ? "string" : "number"));
+    }
+    value = eval;
+  }
+};
+
+// настройки публикуются неизменяемыми снимками: читатель берет снимок целиком и работает с ним,
+// а перезагрузка в фоне атомарно подменяет указатель на новый снимок
 class Config
 {
 public:
@@ -13,20 +247,110 @@ public:
     reload();
   }
 
-  // загружает настройки из файла settings.json заново
+  // настройки, заданные в коде, без чтения settings.json (замеры и проверки)
+  explicit Config(const settings &values) : values(make_shared<const settings>(values))
+  {
+  }
+
+  ~Config()
+  {
+    watching = false;
+    if (watcher.joinable())
+      watcher.join();
+  }
+
+  // загружает настройки из файла settings.json заново; при ошибке остаются прежние настройки
   void reload()
   {
     std::ifstream fin(project_path + "settings.json");
-    fin >> config;
+    if (!fin)
+      throw runtime_error("can't open " + project_path + "settings.json");
+    // в settings.json допускаются комментарии после значений
+    auto fresh = make_shared<const settings>(settings::parse(json::parse(fin, nullptr, true, true)));
     fin.close();
+    atomic_store(&values, shared_ptr<const settings>(move(fresh)));
+  }
+
+  // текущий снимок настроек: игровой цикл и поиск читают только его, без поиска по json
+  shared_ptr<const settings> snapshot() const
+  {
+    return atomic_load(&values);
   }
 
-  // оператор () позволяет красиво получать значения настроек по пути, к примеру: config("Bot", "IsWhiteBot") вместо config["Bot"]["IsWhiteBot"]
-  auto operator()(const string &setting_dir, const string &setting_name) const
+  // перезагрузка settings.json в фоне при каждом изменении файла (если включено WatchSettings).
+  // notify вызывается из фонового потока: с пустой строкой после перезагрузки или с текстом ошибки
+  void watch(function<void(const string &error)> notify)
   {
-    return config[setting_dir][setting_name];
+    if (!snapshot()->watch_settings || watcher.joinable())
+      return;
+    watching = true;
+    watcher = thread(&Config::watch_loop, this, move(notify));
   }
 
 private:
-  json config;
+  void try_reload(const function<void(const string &)> &notify)
+  {
+    try
+    {
+      reload();
+      notify("");
+    }
+    catch (const exception &e)
+    {
+      notify(e.what());
+    }
+  }
+
+  void watch_loop(const function<void(const string &)> notify)
+  {
+    const string path = project_path + "settings.json";
+#ifdef __linux__
+    // inotify следит за каталогом: редакторы часто заменяют файл переименованием
+    const int fd = inotify_init1(IN_NONBLOCK);
+    const string dir = project_path.empty() ? "." : project_path;
+    if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+      notify("can't watch " + path);
+      if (fd >= 0)
+        close(fd);
+      return;
+    }
+    alignas(inotify_event) char buffer[4096];
+    while (watching)
+    {
+      pollfd pfd{fd, POLLIN, 0};
+      if (poll(&pfd, 1, 200) <= 0)
+        continue;
+      const ssize_t n = read(fd, buffer, sizeof(buffer));
+      bool changed = false;
+      for (ssize_t pos = 0; pos < n;)
+      {
+        const inotify_event *event = (const inotify_event *)(buffer + pos);
+        changed |= event->len && string(event->name) == "settings.json";
+        pos += sizeof(inotify_event) + event->len;
+      }
+      if (changed)
+        try_reload(notify);
+    }
+    close(fd);
+#else
+    // без inotify - проверка времени изменения файла
+    error_code ec;
+    auto last = filesystem::last_write_time(path, ec);
+    while (watching)
+    {
+      this_thread::sleep_for(chrono::milliseconds(200));
+      const auto time = filesystem::last_write_time(path, ec);
+      if (!ec && time != last)
+      {
+        last = time;
+        try_reload(notify);
+      }
+    }
+#endif
+  }
+
+  shared_ptr<const settings> values; // текущий снимок, читается и подменяется через atomic_load/atomic_store
+  thread watcher;                    // поток наблюдения за settings.json
+  atomic<bool> watching{false};
 };
@@ -0,0 +1,149 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include "Batch_eval.h"
+
+using namespace std;
+
+// аккумулятор первого слоя для оценок, обновляемых пошагово при выполнении хода
+struct alignas(32) eval_acc
+{
+    int16_t v[64];
+};
+
+// интерфейс оценки позиции: одна виртуальная функция на позицию или на пакет позиций
+class Evaluator
+{
+public:
+    virtual ~Evaluator() = default;
+
+    // оценка для бота цвета color: отношение сил бота к силам противника (0 - проигрыш, INF - выигрыш)
+    virtual double score(const packed_pos &pos, const bool color) const = 0;
+    virtual void score(const pos_batch &batch, const bool color, double *out) const = 0;
+
+    // отпечаток оценки (тип и веса), чтобы в общей таблице транспозиций не смешивались оценки разных ботов
+    virtual uint64_t signature() const = 0;
+
+    // оценки с аккумулятором (NNUE) переопределяют функции ниже, поиск тогда ведет стек аккумуляторов
+    virtual bool incremental() const
+    {
+        return false;
+    }
+    // пересчет аккумулятора для позиции с нуля
+    virtual void refresh(const packed_pos & /*pos*/, eval_acc & /*acc*/) const
+    {
+    }
+    // аккумулятор после хода turn фигурой piece со взятием фигуры captured (0 - без взятия)
+    virtual void update(const eval_acc & /*parent*/, const POS_T /*piece*/, const POS_T /*captured*/,
+                        const move_pos & /*turn*/, eval_acc & /*child*/) const
+    {
+    }
+    // оценка позиции с готовым аккумулятором
+    virtual double score(const eval_acc & /*acc*/, const packed_pos &pos, const bool color) const
+    {
+        return score(pos, color);
+    }
+
+    // хеш FNV-1a блока памяти
+    static uint64_t hash_bytes(const void *data, const size_t size, uint64_t hash = 0xCBF29CE484222325ull)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= ((const uint8_t *)data)[i];
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+};
+
+// линейная оценка: все слагаемые считаются за один проход и умножаются на плоскую таблицу весов
+class Linear_eval : public Evaluator
+{
+public:
+    Linear_eval(const eval_weights &weights) : kernels(weights)
+    {
+    }
+
+    double score(const packed_pos &pos, const bool color) const override
+    {
+        return kernels.score(pos, color);
+    }
+
+    void score(const pos_batch &batch, const bool color, double *out) const override
+    {
+        kernels.score(batch, color, out);
+    }
+
+    uint64_t signature() const override
+    {
+        return hash_bytes(kernels.weights.weight, sizeof(kernels.weights.weight));
+    }
+
+    const eval_weights &weights() const
+    {
+        return kernels.weights;
+    }
+
+private:
+    Batch_eval kernels;
+};
+
+// реестр оценок по названию BotScoringType
+class Evaluators
+{
+public:
+    // фабрика получает веса слагаемых, переопределенные в настройках бота
+    typedef function<shared_ptr<const Evaluator>(const nlohmann::json &weights)> factory;
+
+    static void add(const string &type, factory make)
+    {
+        registry()[type] = make;
+    }
+
+    static shared_ptr<const Evaluator> make(const string &type, const nlohmann::json &weights)
+    {
+        auto it = registry().find(type);
+        if (it == registry().end())
+            throw runtime_error("unknown BotScoringType " + type);
+        return it->second(weights);
+    }
+
+private:
+    static map<string, factory> &registry()
+    {
+        static map<string, factory> types = builtin();
+        return types;
+    }
+
+    // встроенные наборы весов линейной оценки
+    static map<string, factory> builtin()
+    {
+        map<string, factory> types;
+        // только количество фигур
+        types["NumberOnly"] = [](const nlohmann::json &weights) {
+            eval_weights w;
+            w.weight[KING] = 4;
+            w.weight[ADVANCEMENT] = 0;
+            w.apply(weights);
+            return make_shared<Linear_eval>(w);
+        };
+        // количество фигур и продвижение шашек
+        types["NumberAndPotential"] = [](const nlohmann::json &weights) {
+            eval_weights w;
+            w.apply(weights);
+            return make_shared<Linear_eval>(w);
+        };
+        // веса, подобранные Tools/tuner.cpp
+        types["Tuned"] = [](const nlohmann::json &weights) {
+            eval_weights w;
+            if (!w.load(project_path + "weights.json"))
+                throw runtime_error("can't load Tuned weights from " + project_path + "weights.json");
+            w.apply(weights);
+            return make_shared<Linear_eval>(w);
+        };
+        return types;
+    }
+};
@@ -1,8 +1,11 @@
 #pragma once
+#include <atomic>
 #include <chrono>
 #include <thread>
 
 #include "../Models/Project_path.h"
+#include "../Models/Record.h"
+#include "Annotate.h"
 #include "Board.h"
 #include "Config.h"
 #include "Hand.h"
@@ -11,10 +14,49 @@
 class Game
 {
 public:
-    Game() : board(config("WindowSize", "Width"), config("WindowSize", "Hight")), hand(&board), logic(&board, &config)
+    // таблица транспозиций выделяется и заполняется из файла в фоне, пока создается окно (см. warm_up)
+    Game()
+        : current(config.snapshot()), board(current->width, current->height), hand(&board), tt(0),
+          logic(&config, &tt)
     {
         ofstream fout(project_path + "log.txt", ios_base::trunc);
         fout.close();
+        // файл трассировки берется из настроек при запуске и записывается при выходе из игры
+        trace_file = current->trace_file;
+        if (!trace_file.empty())
+        {
+            Trace::start();
+            Trace::name_thread("game");
+        }
+        tt_file = current->tt_file;
+        warm_up();
+        // изменения settings.json применяются между ходами без перезапуска
+        config.watch([](const string &error) {
+            Trace::name_thread("settings watcher");
+            trace_scope trace("log");
+            ofstream fout(project_path + "log.txt", ios_base::app);
+            if (error.empty())
+                fout << "Settings reloaded\n";
+            else
+                fout << "Error: " << error << "\n";
+        });
+    }
+
+    ~Game()
+    {
+        wait_warm_up();
+        stop_annotation();
+        if (!tt_file.empty() && !tt.save(project_path + tt_file, logic.tt_signature(),
+                                         uint8_t(min(current->tt_file_depth, 255u))))
+        {
+            ofstream fout(project_path + "log.txt", ios_base::app);
+            fout << "Error: can't write TT file " << project_path + tt_file << "\n";
+        }
+        if (!trace_file.empty() && !Trace::write(project_path + trace_file))
+        {
+            ofstream fout(project_path + "log.txt", ios_base::app);
+            fout << "Error: can't write trace file " << project_path + trace_file << "\n";
+        }
     }
 
     // to start checkers
@@ -24,34 +66,63 @@ public:
         // проверка на повтор игры
         if (is_replay)
         {
-            logic = Logic(&board, &config);
+            // оценка прошлой партии занимает таблицу транспозиций
+            stop_annotation();
+            // сначала перечитываются настройки, затем по ним создается поиск
             config.reload();
+            update_settings();
+            logic = Logic(&config, &tt);
             board.redraw();
         }
         else
         {
             board.start_draw();
+            // первый кадр показан, движок готовился параллельно с созданием окна
+            const long long first_frame = since_launch();
+            wait_warm_up();
+            if (!warm_up_error.empty())
+                throw runtime_error(warm_up_error);
+            trace_scope log_trace("log");
+            ofstream fout(project_path + "log.txt", ios_base::app);
+            if (!tt_file.empty())
+                fout << "TT file entries loaded: " << tt_loaded << "\n";
+            fout << "Startup: first frame " << first_frame << " millisec, engine ready " << engine_ready_ms
+                 << " millisec\n";
         }
         is_replay = false;
 
         int turn_num = -1;
         bool is_quit = false;
-        const int Max_turns = config("Game", "MaxNumTurns"); // основной игровой цикл
-        while (++turn_num < Max_turns)
+        bool is_draw = false;
+        // основной игровой цикл
+        while (++turn_num < int(current->max_turns))
         {
             beat_series = 0;
+            // настройки, перезагруженные во время игры, вступают в силу с этого хода
+            update_settings();
+            const settings &s = *current;
+            // позиция хода в истории партии (после отката ходов история укорачивается),
+            // ничья по повторению позиции или по ходам без продвижения
+            logic.history.resize(turn_num);
+            logic.history.push(packed_pos(board.get_board()), turn_num % 2);
+            if (logic.history.is_draw(s.repetition_draw, 2 * size_t(s.no_progress_moves)))
+            {
+                is_draw = true;
+                break;
+            }
             // поиск возможных ходов для текущего игрока
-            logic.find_turns(turn_num % 2);
+            logic.find_turns(turn_num % 2, board.get_board());
             // если нет ходов - игра окончена
             if (logic.turns.empty())
                 break;
             // установка уровня сложности бота
-            logic.Max_depth = config("Bot", string((turn_num % 2) ? "Black" : "White") + string("BotLevel"));
+            logic.Max_depth = s.bot[turn_num % 2].level;
             // проверка кто ходит - человек или бот
-            if (!config("Bot", string("Is") + string((turn_num % 2) ? "Black" : "White") + string("Bot")))
+            if (!s.bot[turn_num % 2].is_bot)
             {
                 // ход человека
                 auto resp = player_turn(turn_num % 2);
+                board.clear_hints();
                 if (resp == Response::QUIT)
                 {
                     is_quit = true;
@@ -65,8 +136,7 @@ public:
                 else if (resp == Response::BACK)
                 {
                     // откат хода
-                    if (config("Bot", string("Is") + string((1 - turn_num % 2) ? "Black" : "White") + string("Bot")) &&
-                        !beat_series && board.history_mtx.size() > 2)
+                    if (s.bot[1 - turn_num % 2].is_bot && !beat_series && board.history_mtx.size() > 2)
                     {
                         board.rollback();
                         --turn_num;
@@ -85,6 +155,7 @@ public:
         }
         // запись времени игры в лог
         auto end = chrono::steady_clock::now();
+        trace_scope log_trace("log");
         ofstream fout(project_path + "log.txt", ios_base::app);
         fout << "Game time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
         fout.close();
@@ -96,7 +167,7 @@ public:
             return 0;
         // определение результата игры
         int res = 2;
-        if (turn_num == Max_turns)
+        if (is_draw || turn_num >= int(current->max_turns))
         {
             res = 0; // ничья
         }
@@ -104,6 +175,10 @@ public:
         {
             res = 1; // победа белых
         }
+        if (current->record_games)
+            record_game(res);
+        if (current->annotate_depth)
+            annotate_game(res);
         // показ результата и ожидание действий игрока
         board.show_final(res);
         auto resp = hand.wait();
@@ -116,17 +191,121 @@ public:
     }
 
 private:
+    // подготовка движка в фоновом потоке: выделение таблицы транспозиций (страницы памяти заполняются нулями),
+    // чтение файла таблицы и таблицы ключей Zobrist. поиск начинается только после wait_warm_up
+    void warm_up()
+    {
+        warm_up_thread = thread([this, size_mb = current->tt_size_mb]() {
+            Trace::name_thread("engine warm-up");
+            trace_scope trace("engine warm-up");
+            try
+            {
+                tt.resize(size_mb);
+                // таблица прошлых запусков: глубоко посчитанные позиции находятся без поиска
+                if (!tt_file.empty())
+                    tt_loaded = tt.load(project_path + tt_file, logic.tt_signature());
+                zobrist::key(packed_pos::start(), false);
+            }
+            catch (const exception &e)
+            {
+                warm_up_error = e.what();
+            }
+            engine_ready_ms = since_launch();
+        });
+    }
+
+    void wait_warm_up()
+    {
+        if (warm_up_thread.joinable())
+            warm_up_thread.join();
+    }
+
+    // миллисекунды от создания игры
+    long long since_launch() const
+    {
+        return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - launch).count();
+    }
+
+    // дописывание сыгранной партии в games.bin для подбора весов оценки
+    void record_game(const int res)
+    {
+        game_record record;
+        record.result = uint8_t(res);
+        for (const auto &mtx : board.history_mtx)
+        {
+            record.positions.emplace_back(mtx);
+        }
+        ofstream fout(project_path + "games.bin", ios_base::app | ios_base::binary);
+        record.write(fout);
+        fout.close();
+    }
+
+    // оценка всех ходов сыгранной партии во всех ядрах с общей таблицей, результат в annotation.json.
+    // оценка идет в фоновом потоке, пока показан результат, и окно не замирает; повтор игры и выход
+    // останавливают ее без записи файла
+    void annotate_game(const int res)
+    {
+        vector<packed_pos> positions;
+        for (const auto &mtx : board.history_mtx)
+            positions.emplace_back(mtx);
+        search_limits limits;
+        limits.depth = current->annotate_depth;
+        annotation_stop = false;
+        annotation_thread = thread([this, res, positions = move(positions), limits]() {
+            Trace::name_thread("annotation");
+            trace_scope trace("annotate");
+            json annotation = {{"result", res}, {"moves", json::array()}};
+            try
+            {
+                const Annotator annotator(&config, &tt, thread::hardware_concurrency());
+                for (const auto &m : annotator.annotate(positions, limits, &annotation_stop))
+                    annotation["moves"].push_back(m.to_json());
+            }
+            catch (const exception &e)
+            {
+                if (annotation_stop)
+                    return;
+                annotation["error"] = e.what();
+            }
+            ofstream fout(project_path + "annotation.json", ios_base::trunc);
+            fout << annotation.dump(2) << "\n";
+        });
+    }
+
+    void stop_annotation()
+    {
+        annotation_stop = true;
+        if (annotation_thread.joinable())
+            annotation_thread.join();
+    }
+
+    // переход на последний снимок настроек: размер таблицы транспозиций и настройки поиска
+    void update_settings()
+    {
+        auto fresh = config.snapshot();
+        if (fresh == current)
+            return;
+        if (fresh->tt_size_mb != current->tt_size_mb)
+            tt.resize(fresh->tt_size_mb);
+        current = move(fresh);
+        logic.update_settings();
+    }
+
     // обработка хода бота
     void bot_turn(const bool color)
     {
+        trace_scope trace("bot turn");
         auto start = chrono::steady_clock::now();
 
-        auto delay_ms = config("Bot", "BotDelayMS");
+        const unsigned delay_ms = current->delay_ms;
         // создание отдельного потока для задержки
         thread th(SDL_Delay, delay_ms);
         // поиск лучших ходов для бота
-        auto turns = logic.find_best_turns(color);
-        th.join();
+        auto turns = logic.find_best_turns(color, board.get_board());
+        {
+            trace_scope delay_trace("bot delay");
+            th.join();
+        }
         bool is_first = true;
         // выполнение найденных ходов
         for (auto turn : turns)
@@ -134,6 +313,7 @@ private:
             // задержка между ходами в серии (кроме первого)
             if (!is_first)
             {
+                trace_scope delay_trace("bot delay");
                 SDL_Delay(delay_ms);
             }
             is_first = false;
@@ -144,14 +324,47 @@ private:
 
         // запись времени хода бота в лог
         auto end = chrono::steady_clock::now();
+        trace_scope log_trace("log");
         ofstream fout(project_path + "log.txt", ios_base::app);
         fout << "Bot turn time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
+        fout << "Bot quiescence nodes: " << logic.qnodes << ", cut by limit: " << logic.qcut << "\n";
+        if (!first_bot_move_logged)
+        {
+            fout << "First bot move: " << since_launch() << " millisec after start\n";
+            first_bot_move_logged = true;
+        }
+        fout.close();
+    }
+
+    // подсказка игроку: лучшие ходы одного поиска корня (Logic::lines) стрелками на доске, оценки - в log.txt
+    void show_hints(const bool color)
+    {
+        trace_scope trace("hint");
+        const size_t level = logic.Max_depth;
+        logic.Max_depth = current->hint_depth;
+        logic.multi_pv = current->hint_lines;
+        logic.find_best_turns(color, board.get_board());
+        logic.multi_pv = 1;
+        logic.Max_depth = level;
+        vector<vector<move_pos>> series;
+        ofstream fout(project_path + "log.txt", ios_base::app);
+        fout << "Hint:";
+        for (const auto &line : logic.lines())
+        {
+            series.push_back(line.series);
+            fout << " " << notation::move(line.series) << " (" << search_info::score_text(line.score) << ")";
+        }
+        fout << "\n";
         fout.close();
+        board.set_hints(move(series));
     }
 
     // обработка хода игрока
     Response player_turn(const bool color)
     {
+        trace_scope trace("player turn");
+        if (current->hint_lines)
+            show_hints(color);
         // подготовка списка возможных ходов для подсветки
         vector<pair<POS_T, POS_T>> cells;
         for (auto turn : logic.turns)
@@ -225,7 +438,7 @@ private:
         beat_series = 1;
         while (true)
         {
-            logic.find_turns(pos.x2, pos.y2);
+            logic.find_turns(pos.x2, pos.y2, board.get_board());
             if (!logic.have_beats)
                 break;
 
@@ -271,10 +484,23 @@ private:
     }
 
 private:
+    const chrono::steady_clock::time_point launch = chrono::steady_clock::now(); // создание игры
     Config config;
+    shared_ptr<const settings> current; // снимок настроек текущего хода
     Board board;
     Hand hand;
+    Transposition tt;
     Logic logic;
     int beat_series;
     bool is_replay = false;
+    string trace_file;                  // файл трассировки ("" - выключена)
+    string tt_file;                     // файл таблицы транспозиций между запусками ("" - не сохраняется)
+    thread warm_up_thread;              // подготовка движка при запуске
+    size_t tt_loaded = 0;               // записей из файла таблицы
+    string warm_up_error;               // ошибка подготовки движка (нехватка памяти под таблицу)
+    long long engine_ready_ms = 0;      // движок готов через столько мс после создания игры
+    thread annotation_thread;           // оценка ходов сыгранной партии
+    // остановка оценки при повторе игры и выходе
+    atomic<bool> annotation_stop{false};
+    bool first_bot_move_logged = false; // время первого хода бота уже записано
 };
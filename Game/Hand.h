@@ -15,6 +15,7 @@ public:
     // получение координат клетки и типа действия
     tuple<Response, POS_T, POS_T> get_cell() const
     {
+        trace_scope trace("input wait");
         SDL_Event windowEvent;
         Response resp = Response::OK;
         int x = -1, y = -1;
@@ -33,20 +34,20 @@ public:
                     x = windowEvent.motion.x;
                     y = windowEvent.motion.y;
                     // преобразование в координаты клетки доски
-                    xc = int(y / (board->H / 10) - 1);
-                    yc = int(x / (board->W / 10) - 1);
+                    xc = int(y / (board->H / Board::grid) - 1);
+                    yc = int(x / (board->W / Board::grid) - 1);
                     // проверка нажатия на кнопку "назад"
                     if (xc == -1 && yc == -1 && board->history_mtx.size() > 1)
                     {
                         resp = Response::BACK;
                     }
                     // проверка нажатия на кнопку "повтор"
-                    else if (xc == -1 && yc == 8)
+                    else if (xc == -1 && yc == Board::N)
                     {
                         resp = Response::REPLAY;
                     }
                     // проверка клика по игровой доске
-                    else if (xc >= 0 && xc < 8 && yc >= 0 && yc < 8)
+                    else if (xc >= 0 && xc < Board::N && yc >= 0 && yc < Board::N)
                     {
                         resp = Response::CELL;
                     }
@@ -74,6 +75,7 @@ public:
     // ожидание действия пользователя (для экрана результатов)
     Response wait() const
     {
+        trace_scope trace("input wait");
         SDL_Event windowEvent;
         Response resp = Response::OK;
         while (true)
@@ -92,10 +94,10 @@ public:
                 {
                     int x = windowEvent.motion.x;
                     int y = windowEvent.motion.y;
-                    int xc = int(y / (board->H / 10) - 1);
-                    int yc = int(x / (board->W / 10) - 1);
+                    int xc = int(y / (board->H / Board::grid) - 1);
+                    int yc = int(x / (board->W / Board::grid) - 1);
                     // проверка нажатия на кнопку "повтор"
-                    if (xc == -1 && yc == 8)
+                    if (xc == -1 && yc == Board::N)
                         resp = Response::REPLAY;
                 }
                 break;
@@ -0,0 +1,108 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "../Models/Position.h"
+#include "Transposition.h"
+
+using namespace std;
+
+// история позиций партии и пути поиска для правил ничьей: повторение позиции и ходы без продвижения.
+// позиция пишется в начале каждого хода (после всей серии взятий). необратимый ход - взятие или ход шашки -
+// обнуляет счетчик обратимых полуходов, и повторения ищутся только среди позиций после него
+class position_history
+{
+public:
+    void clear()
+    {
+        entries.clear();
+        fill(begin(filter), end(filter), 0);
+    }
+
+    bool empty() const
+    {
+        return entries.empty();
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    // ключ Zobrist последней позиции
+    uint64_t top_key() const
+    {
+        return entries.back().key;
+    }
+
+    const packed_pos &top_pos() const
+    {
+        return entries.back().pos;
+    }
+
+    void push(const packed_pos &pos, const bool color)
+    {
+        entry e;
+        e.pos = pos;
+        e.key = zobrist::key(pos, color);
+        // те же шашки на тех же местах и то же число фигур - ходили только дамки
+        if (!entries.empty())
+        {
+            const packed_pos &prev = entries.back().pos;
+            if ((prev.w | prev.b) == (pos.w | pos.b) &&
+                __builtin_popcount(prev.wq | prev.bq) == __builtin_popcount(pos.wq | pos.bq))
+                e.reversible = uint16_t(entries.back().reversible + 1);
+        }
+        ++filter[e.key & filter_mask];
+        entries.push_back(e);
+    }
+
+    void pop()
+    {
+        --filter[entries.back().key & filter_mask];
+        entries.pop_back();
+    }
+
+    // откат истории до первых n позиций
+    void resize(const size_t n)
+    {
+        while (entries.size() > n)
+            pop();
+    }
+
+    // ничья в последней позиции: ее repetitions-е появление (0 - правило выключено) или no_progress
+    // обратимых полуходов подряд (0 - выключено). повторение позиции пути поиска, появившейся после
+    // корня path_start, - ничья сразу: те же ходы повторят ее снова. проверка почти всегда - одно
+    // обращение к фильтру, позиции перебираются, только если ее ключ уже встречался
+    bool is_draw(const size_t repetitions, const size_t no_progress, const size_t path_start = SIZE_MAX) const
+    {
+        const entry &e = entries.back();
+        if (no_progress && e.reversible >= no_progress)
+            return true;
+        if (!repetitions || filter[e.key & filter_mask] < 2)
+            return false;
+        const size_t last = entries.size() - 1;
+        size_t count = 1;
+        // та же сторона ходит через полуход
+        for (size_t back = 2; back <= e.reversible; back += 2)
+        {
+            const size_t i = last - back;
+            if (entries[i].key == e.key && (i > path_start || ++count >= repetitions))
+                return true;
+        }
+        return false;
+    }
+
+private:
+    struct entry
+    {
+        packed_pos pos;
+        uint64_t key = 0;        // позиция и ходящая сторона
+        uint16_t reversible = 0; // обратимых полуходов до этой позиции
+    };
+
+    static constexpr size_t filter_mask = 1023;
+    vector<entry> entries;
+    uint16_t filter[filter_mask + 1] = {}; // число позиций истории по младшим битам ключа
+};
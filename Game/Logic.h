@@ -1,408 +1,1039 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <functional>
+#include <mutex>
 #include <random>
+#include <thread>
 #include <vector>
 
 #include "../Models/Move.h"
-#include "Board.h"
+#include "../Models/Position.h"
 #include "Config.h"
+#include "Evaluator.h"
+#include "History.h"
+#include "Movegen.h"
+#include "Nnue_eval.h"
+#include "Trace.h"
+#include "Transposition.h"
 
-const int INF = 1e9;
+// ограничения одного поиска, общие для основного и вспомогательных поисков:
+// проверяются каждые Logic::budget_check узлов, превышение любого прерывает поиск
+struct search_budget
+{
+    size_t max_nodes = 0;               // лимит узлов (0 - без лимита)
+    size_t max_memory = 0;              // лимит памяти в байтах (0 - без лимита)
+    size_t fixed_memory = 0;            // общая таблица транспозиций
+    const atomic<bool> *stop = nullptr; // внешний флаг остановки
+    // срок окончания поиска (по умолчанию - без срока)
+    chrono::steady_clock::time_point deadline{};
+    atomic<size_t> nodes{0};            // узлы всех потоков на момент проверок
+    atomic<size_t> memory{0};           // память поисков сверх общей таблицы: свои таблицы, журналы, стеки
+    atomic<bool> aborted{false};
+};
+
+// вариант корня в режиме нескольких лучших ходов (MultiPV)
+struct root_line
+{
+    double score = -1;       // точная оценка хода для бота
+    vector<move_pos> series; // ход с продолжением серии взятий
+    vector<move_pos> pv;     // главный вариант, начиная с хода
+};
 
 class Logic
 {
+    typedef movegen<geometry8> rules; // правила и доска игры
+
 public:
-    Logic(Board *board, Config *config) : board(board), config(config)
+    // tt - таблица транспозиций, может быть общей для нескольких Logic в разных потоках
+    Logic(Config *config, Transposition *tt = nullptr) : config(config), tt(tt)
     {
-        rand_eng = std::default_random_engine(
-            !((*config)("Bot", "NoRandom")) ? unsigned(time(0)) : 0);
-        scoring_mode = (*config)("Bot", "BotScoringType");
-        optimization = (*config)("Bot", "Optimization");
+        apply_settings(config->snapshot());
+        pv_table.resize(2);
     }
 
-    // поиск лучших ходов
-    vector<move_pos> find_best_turns(const bool color)
+    // переход на новый снимок настроек, если settings.json перезагружен после прошлого вызова.
+    // вызывается на границе ходов, когда поиск не идет
+    void update_settings()
     {
-        // инициализация переменных
-        next_move.clear();
+        auto fresh = config->snapshot();
+        if (fresh != current)
+            apply_settings(move(fresh));
+    }
+
+    // поиск лучших ходов в позиции mtx, возвращает всю серию ходов бота (для боя - все взятия подряд)
+    vector<move_pos> find_best_turns(const bool color, const vector<vector<POS_T>> &mtx)
+    {
+        trace_scope trace("search");
         next_best_state.clear();
+        next_move.clear();
+        nodes = 0;
+        qnodes = 0;
+        qcut = 0;
+        if (tt)
+            tt->new_search();
+        budget = make_shared<search_budget>();
+        budget->max_nodes = Max_nodes;
+        budget->max_memory = max_memory_mb << 20;
+        budget->fixed_memory = tt ? tt->size_mb() << 20 : 0;
+        budget->stop = stop;
+        budget->deadline = deadline;
+        aborted = false;
+        reported_memory = 0;
+        enter_root(mtx, color);
+        // корень - последняя позиция истории партии; без истории (или с историей другой партии)
+        // повторения считаются только в пути поиска
+        const packed_pos root(mtx);
+        if (history.empty() || history.top_key() != zobrist::key(root, color))
+        {
+            history.clear();
+            history.push(root, color);
+        }
+        path_start = history.size() - 1;
+        // варианты прошлого поиска той же позиции задают порядок ходов корня
+        if (root_key != history.top_key())
+            root_lines.clear();
+        root_key = history.top_key();
+
+        last_score = find_first_best_turn(mtx, color, -1, -1, 0);
+        trace.arg("level", (long long)Max_depth);
+        trace.arg("nodes", (long long)nodes);
+        return best_series();
+    }
+
+    // текущий снимок настроек поиска
+    const shared_ptr<const settings> &snapshot() const
+    {
+        return current;
+    }
+
+    // зерно случайности порядка ходов: партии матча воспроизводятся по зерну задания
+    void seed(const unsigned value)
+    {
+        rand_eng.seed(value);
+    }
+
+    // подпись оценок обоих ботов и настроек поиска, от которых зависят записи таблицы (для файла таблицы)
+    uint64_t tt_signature() const
+    {
+        return Evaluator::hash_bytes(tt_salt, sizeof(tt_salt));
+    }
 
-        // поиск всех возможных ходов для текущ. цвета
-        find_turns(color);
+    // главный вариант последнего поиска: ходы обеих сторон (по одному взятию серии), начиная с корня
+    const vector<move_pos> &pv() const
+    {
+        return pv_table[0];
+    }
+
+    // лучшие ходы корня последнего поиска с точными оценками (не больше multi_pv), по убыванию оценки;
+    // первый - ход find_best_turns. в прерванном поиске - только досчитанные ходы
+    const vector<root_line> &lines() const
+    {
+        return root_lines;
+    }
 
-        // если нет ходов, возвращаем пустой список
-        if (turns.empty())
+private:
+    void apply_settings(shared_ptr<const settings> s)
+    {
+        threads = max<size_t>(1, s->threads);
+        max_memory_mb = s->max_memory_mb;
+        deterministic = s->deterministic;
+        helpers.clear();
+        if (!current || current->no_random != s->no_random)
+            rand_eng = std::default_random_engine(!s->no_random ? unsigned(time(0)) : 0);
+        optimization = s->optimization;
+        quiescence_nodes = s->quiescence_nodes;
+        selective = s->selective;
+        repetition_draw = s->repetition_draw;
+        no_progress_plies = 2 * size_t(s->no_progress_moves);
+        // оценка бота: тип из WhiteBotEval/BlackBotEval ("Type") или BotScoringType, веса слагаемых из них же.
+        // оценка создается заново только при изменении ее настроек (сеть NNUE читается из файла)
+        for (int c = 0; c < 2; ++c)
         {
-            return turns;
+            if (!current || current->eval_type(c) != s->eval_type(c) || current->bot[c].eval != s->bot[c].eval)
+                evaluators[c] = Evaluators::make(s->eval_type(c), s->bot[c].eval);
         }
+        // записи таблицы зависят от оценки бота, от продолжения взятий за горизонтом, от выборочного поиска
+        // и от правил ничьей
+        const selective_settings &sel = selective;
+        const double selective_key[] = {double(sel.lmr),           double(sel.lmr_depth),
+                                        double(sel.lmr_moves),     double(sel.lmr_reduction),
+                                        double(sel.probcut),       double(sel.probcut_depth),
+                                        double(sel.probcut_reduction), sel.probcut_margin,
+                                        double(sel.futility),      double(sel.futility_depth),
+                                        sel.futility_margin,       double(repetition_draw),
+                                        double(no_progress_plies)};
+        for (int c = 0; c < 2; ++c)
+            tt_salt[c] = Evaluator::hash_bytes(
+                selective_key, sizeof(selective_key),
+                Evaluator::hash_bytes(&quiescence_nodes, sizeof(quiescence_nodes), evaluators[c]->signature()));
+        current = move(s);
+    }
 
-        // если только один ход, возвращаем его
-        if (turns.size() == 1)
+    // корень поиска: уровень 0 и аккумулятор оценки для позиции mtx
+    void enter_root(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        ply = 0;
+        reduced = 0;
+        // списки ходов всех уровней выделяются до поиска: спокойных ходов не больше Max_depth + 1,
+        // взятий на пути - не больше числа фигур
+        if (move_stack.size() < Max_depth + 2 + max_captures)
+            move_stack.resize(Max_depth + 2 + max_captures);
+        if (evaluators[color]->incremental())
         {
-            return turns;
+            acc_stack.resize(1);
+            evaluators[color]->refresh(packed_pos(mtx), acc_stack[0]);
         }
+    }
 
-        // получение текущего состояния доски
-        vector<vector<POS_T>> current_board = board->get_board();
-        double best_score = -1;
-        vector<move_pos> best_moves;
-
-        // перебор всех возможных ходов
-        for (size_t i = 0; i < turns.size(); ++i)
+    // восстановление лучшей серии ходов по цепочке состояний, начиная с состояния cur_state
+    vector<move_pos> best_series(int cur_state = 0) const
+    {
+        vector<move_pos> res;
+        do
         {
-            // создание копии доски и выполнение хода
-            vector<vector<POS_T>> temp_board = make_turn(current_board, turns[i]);
+            res.push_back(next_move[cur_state]);
+            cur_state = next_best_state[cur_state];
+        } while (cur_state != -1 && next_move[cur_state].x != -1);
+        return res;
+    }
 
-            // рекурсивный поиск оценки для этого хода
-            double score;
-            if (Max_depth <= 1)
-            {
-                // если глубина 1, просто оцениваем позицию
-                score = calc_score(temp_board, color);
-            }
-            else
-            {
-                // иначе запускаем рекурсивный поиск
-                score = find_best_turns_rec(temp_board, !color, Max_depth - 1, -1, INF + 1);
-            }
+    // нижняя граница окна хода корня: оценка последнего из multi_pv лучших досчитанных ходов.
+    // ход с оценкой выше нее получает точную оценку, остальные - только верхнюю границу
+    double lines_bound(const vector<root_line> &lines) const
+    {
+        return lines.size() < multi_pv ? -1 : lines[multi_pv - 1].score;
+    }
 
-            // обновление лучшего результата
-            if (score > best_score)
-            {
-                best_score = score;
-                best_moves.clear();
-                best_moves.push_back(turns[i]);
-            }
-            else if (abs(score - best_score) < 1e-9)
+    // вариант с точной оценкой в список лучших, упорядоченный по убыванию (из равных раньше - первый найденный)
+    void add_line(vector<root_line> &lines, root_line line) const
+    {
+        auto pos = lines.begin();
+        while (pos != lines.end() && pos->score >= line.score)
+            ++pos;
+        lines.insert(pos, move(line));
+        if (lines.size() > multi_pv)
+            lines.pop_back();
+    }
+
+    // первые ходы вариантов прошлой итерации углубления - в начало списка корня в их порядке:
+    // они первыми получают точные оценки, и окно остальных ходов сразу узкое
+    void lines_first(move_list &turns_now) const
+    {
+        size_t placed = 0;
+        for (const auto &line : root_lines)
+        {
+            for (size_t i = placed; i < turns_now.size(); ++i)
             {
-                // добавление хода с равной оценкой
-                best_moves.push_back(turns[i]);
+                if (turns_now[i] == line.series[0])
+                {
+                    rotate(turns_now.begin() + placed, turns_now.begin() + i, turns_now.begin() + i + 1);
+                    ++placed;
+                    break;
+                }
             }
         }
+    }
 
-        return best_moves;
+    // результат поиска одного хода корня
+    struct root_result
+    {
+        double score = -1;
+        double alpha = -1;          // нижняя граница окна: оценка не выше нее - только верхняя граница
+        vector<move_pos> series;    // ход с продолжением серии взятий
+        vector<move_pos> pv;        // главный вариант, начиная с хода
+        size_t nodes = 0, qnodes = 0, qcut = 0;
+        vector<pair<uint64_t, tt_entry>> tt_log; // записи таблицы задачи (детерминированный поиск)
+        bool complete = false;                  // задача не прервана ограничениями
+    };
+
+    // память поиска сверх общей таблицы: своя таблица, журнал ее записей и стеки уровней
+    size_t memory_used() const
+    {
+        return (local_tt ? local_tt->size_mb() << 20 : 0) + tt_log.capacity() * sizeof(tt_log[0]) +
+               acc_stack.capacity() * sizeof(eval_acc) + move_stack.capacity() * sizeof(move_list) + ply * ply_bytes;
     }
 
-private:
-    // выполнение хода на копии доски
-    vector<vector<POS_T>> make_turn(vector<vector<POS_T>> mtx, move_pos turn) const
+    // проверка ограничений поиска: узлы и память учитываются в общем бюджете всех потоков
+    void check_budget()
     {
-        // удаление съеденной фигуры
-        if (turn.xb != -1)
-            mtx[turn.xb][turn.yb] = 0;
-        // превращение в дамку при достижении края
-        if ((mtx[turn.x][turn.y] == 1 && turn.x2 == 0) || (mtx[turn.x][turn.y] == 2 && turn.x2 == 7))
-            mtx[turn.x][turn.y] += 2;
-        // перемещение фигуры
-        mtx[turn.x2][turn.y2] = mtx[turn.x][turn.y];
-        mtx[turn.x][turn.y] = 0;
-        return mtx;
+        search_budget &b = *budget;
+        const size_t total = b.nodes.fetch_add(budget_check) + budget_check;
+        const size_t memory = memory_used();
+        b.memory.fetch_add(memory - reported_memory);
+        reported_memory = memory;
+        if ((b.stop && *b.stop) || (b.max_nodes && total >= b.max_nodes) ||
+            (b.max_memory && b.fixed_memory + b.memory.load() >= b.max_memory) ||
+            (b.deadline != chrono::steady_clock::time_point{} && chrono::steady_clock::now() >= b.deadline))
+            b.aborted = true;
+        aborted = b.aborted;
     }
 
-    // вычисление оценки позиции для бота
-    double calc_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color) const
+    // цепочка состояний для готовой серии ходов
+    void set_series(const vector<move_pos> &series)
+    {
+        next_move = series;
+        next_best_state.resize(next_move.size());
+        for (size_t i = 0; i < next_move.size(); ++i)
+            next_best_state[i] = (i + 1 < next_move.size() ? int(i + 1) : -1);
+    }
+
+    // ход для прерванного поиска, в котором ни один ход корня не досчитан: первый по порядку
+    // (лучший ход прошлой итерации из таблицы), серия взятий дополняется первыми продолжениями
+    void set_first_series(const vector<vector<POS_T>> &mtx, move_pos turn)
+    {
+        vector<move_pos> series;
+        auto board = mtx;
+        move_list next;
+        while (true)
+        {
+            series.push_back(turn);
+            if (turn.xb == -1)
+                break;
+            board = make_turn(board, turn);
+            next.clear();
+            rules::piece_turns(turn.x2, turn.y2, board, next);
+            if (!next.have_beats)
+                break;
+            turn = next[0];
+        }
+        set_series(series);
+        pv_table[0] = series;
+    }
+
+    // вспомогательные поиски по одному на поток: копии этого поиска с настройками, глубиной и таблицами
+    void prepare_helpers()
+    {
+        if (helpers.size() != threads)
+        {
+            helpers.clear();
+            const Logic proto = *this;
+            helpers.assign(threads, proto);
+        }
+        // в детерминированном режиме задачи пишут в свои таблицы, общая во время задач только читается
+        const size_t task_tt_mb = max<size_t>(1, current->tt_size_mb / 8);
+        for (auto &h : helpers)
+        {
+            h.Max_depth = Max_depth;
+            h.history = history;
+            h.path_start = path_start;
+            h.budget = budget;
+            h.threads = 1;
+            h.frozen_tt = nullptr;
+            h.tt = tt;
+            if (deterministic && tt && tt->enabled())
+            {
+                if (!h.local_tt)
+                    h.local_tt = make_shared<Transposition>(task_tt_mb);
+                h.tt = h.local_tt.get();
+                h.frozen_tt = tt;
+            }
+        }
+    }
+
+    // поиск одного хода корня во вспомогательном поиске с окном (alpha, INF + 1)
+    root_result search_root_turn(const vector<vector<POS_T>> &mtx, const bool color, const move_pos &turn,
+                                 const bool have_beats_now, const double alpha, const unsigned seed)
     {
-        double w = 0, wq = 0, b = 0, bq = 0;
-        // подсчет количества фигур каждого типа
-        for (POS_T i = 0; i < 8; ++i)
+        trace_scope trace("root move");
+        nodes = 0;
+        qnodes = 0;
+        qcut = 0;
+        root_result res;
+        aborted = budget->aborted;
+        if (aborted)
+            return res;
+        rand_eng.seed(seed);
+        if (local_tt)
+            local_tt->clear();
+        tt_log.clear();
+        enter_root(mtx, color);
+        clear_pv();
+        next_move.assign(1, turn);
+        next_best_state.assign(1, -1);
+        if (have_beats_now)
+        {
+            res.score = find_first_best_turn(enter_turn(mtx, turn, color), color, turn.x2, turn.y2, 1, alpha);
+            next_best_state[0] = 1;
+        }
+        else
         {
-            for (POS_T j = 0; j < 8; ++j)
+            res.score = find_best_turns_rec(enter_turn(mtx, turn, color), !color, 0, alpha);
+        }
+        leave_turn();
+        update_pv(turn);
+        res.alpha = alpha;
+        res.series = best_series();
+        res.pv = pv_table[0];
+        res.nodes = nodes;
+        res.qnodes = qnodes;
+        res.qcut = qcut;
+        res.tt_log.swap(tt_log);
+        res.complete = !aborted;
+        trace.arg("nodes", (long long)nodes);
+        return res;
+    }
+
+    // корень в нескольких потоках: каждый ход корня - задача вспомогательного поиска.
+    // первый ход ищется с полным окном, остальные - с окном от оценки multi_pv-го лучшего из известных.
+    // в детерминированном режиме окно остальных ходов - оценка первого (с несколькими вариантами - полное),
+    // у задачи свое зерно случайности и своя таблица, а ходы распределены по потокам заранее
+    // (ход i - потоку i % threads), поэтому ход, оценка и число узлов не зависят от числа потоков и скорости их работы
+    double parallel_root(const vector<vector<POS_T>> &mtx, const bool color, const move_list &turns_now,
+                         const bool have_beats_now)
+    {
+        prepare_helpers();
+        const unsigned seed = unsigned(rand_eng());
+        vector<root_result> results(turns_now.size());
+        results[0] = helpers[0].search_root_turn(mtx, color, turns_now[0], have_beats_now, -1, seed);
+        // лучшие оценки досчитанных ходов по убыванию, не больше multi_pv
+        vector<double> best_scores(1, results[0].score);
+        mutex best_guard;
+        auto work = [&](const size_t t) {
+            for (size_t i = 1 + t; i < turns_now.size(); i += helpers.size())
             {
-                w += (mtx[i][j] == 1);  // белые шашки
-                wq += (mtx[i][j] == 3); // белые дамки
-                b += (mtx[i][j] == 2);  // черные шашки
-                bq += (mtx[i][j] == 4); // черные дамки
-                // дополнительные очки за близость к превращению
-                if (scoring_mode == "NumberAndPotential")
+                double alpha = multi_pv > 1 ? -1 : results[0].score;
+                if (!deterministic)
+                {
+                    lock_guard<mutex> lock(best_guard);
+                    alpha = best_scores.size() < multi_pv ? -1 : best_scores.back();
+                }
+                results[i] = helpers[t].search_root_turn(mtx, color, turns_now[i], have_beats_now, alpha,
+                                                         seed + unsigned(i));
+                // журнал готовой задачи хранится до конца корня
+                budget->memory.fetch_add(results[i].tt_log.capacity() * sizeof(results[i].tt_log[0]));
+                if (results[i].score > alpha)
                 {
-                    w += 0.05 * (mtx[i][j] == 1) * (7 - i); // белые ближе к верху
-                    b += 0.05 * (mtx[i][j] == 2) * (i);     // черные ближе к низу
+                    lock_guard<mutex> lock(best_guard);
+                    best_scores.insert(upper_bound(best_scores.begin(), best_scores.end(), results[i].score,
+                                                   greater<double>()),
+                                       results[i].score);
+                    if (best_scores.size() > multi_pv)
+                        best_scores.pop_back();
                 }
             }
+        };
+        if (helpers.size() == 1)
+            work(0);
+        else
+        {
+            vector<thread> pool;
+            for (size_t t = 0; t < helpers.size(); ++t)
+                pool.emplace_back([&work, t]() {
+                    Trace::name_thread("root helper " + to_string(t));
+                    work(t);
+                });
+            for (auto &th : pool)
+                th.join();
+        }
+        // лучший ход - с наибольшей точной оценкой (выше своего окна), из равных - первый по порядку;
+        // задачи, прерванные ограничениями, не учитываются
+        aborted = budget->aborted;
+        int best = -1;
+        root_lines.clear();
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            nodes += results[i].nodes;
+            qnodes += results[i].qnodes;
+            qcut += results[i].qcut;
+            if (!results[i].complete || (i != 0 && results[i].score <= results[i].alpha))
+                continue;
+            if (best == -1 || results[i].score > results[best].score)
+                best = int(i);
+            add_line(root_lines, {results[i].score, results[i].series, results[i].pv});
         }
-        // корректировка для цвета бота
-        if (!first_bot_color)
+        // записи задач переносятся в общую таблицу в порядке ходов, поэтому ее содержимое тоже детерминировано
+        if (deterministic && tt)
         {
-            swap(b, w);
-            swap(bq, wq);
+            for (const auto &r : results)
+                for (const auto &record : r.tt_log)
+                    if (r.complete)
+                        tt->store(record.first, record.second);
         }
-        // проверка на окончание игры
-        if (w + wq == 0)
-            return INF; // бот выиграл
-        if (b + bq == 0)
-            return 0; // бот проиграл
-        // расчет итоговой оценки с учетом веса дамок
-        int q_coef = 4;
-        if (scoring_mode == "NumberAndPotential")
+        if (best == -1)
         {
-            q_coef = 5;
+            set_first_series(mtx, turns_now[0]);
+            return -1;
         }
-        return (b + bq * q_coef) / (w + wq * q_coef);
+        const root_result &r = results[best];
+        set_series(r.series);
+        pv_table[0] = r.pv;
+        return r.score;
     }
 
-    // объявление функции поиска первого лучшего хода
-    double find_first_best_turn(vector<vector<POS_T>> mtx, const bool color, const POS_T x, const POS_T y, size_t state,
-                                double alpha)
+    // выполнение хода на копии доски
+    static vector<vector<POS_T>> make_turn(const vector<vector<POS_T>> &mtx, const move_pos &turn)
     {
-        // поиск ходов для конкретной фигуры
-        find_turns(x, y, mtx);
+        return rules::make_turn(mtx, turn);
+    }
 
-        // если нет ходов то возвращаем оценку текущей позиции
-        if (turns.empty())
-        {
-            return calc_score(mtx, color);
-        }
+    // вычисление оценки позиции для бота
+    double calc_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color) const
+    {
+        return calc_score(packed_pos(mtx), first_bot_color);
+    }
 
-        double best_score = (alpha == -1) ? 0 : alpha;
+    double calc_score(const packed_pos &pos, const bool first_bot_color) const
+    {
+        const Evaluator &eval = *evaluators[first_bot_color];
+        if (eval.incremental())
+            return eval.score(acc_stack[ply], pos, first_bot_color);
+        return eval.score(pos, first_bot_color);
+    }
 
-        // перебор всех возможных ходов для данной фигуры
-        for (const auto &turn : turns)
+    // переход на следующий уровень поиска: ход на копии доски и обновление аккумулятора оценки бота
+    vector<vector<POS_T>> enter_turn(const vector<vector<POS_T>> &mtx, const move_pos &turn, const bool bot_color)
+    {
+        if ((++nodes & (budget_check - 1)) == 0 && budget)
+            check_budget();
+        const Evaluator &eval = *evaluators[bot_color];
+        if (eval.incremental())
         {
-            // выполнение хода на копии доски
-            vector<vector<POS_T>> new_mtx = make_turn(mtx, turn);
+            if (acc_stack.size() < ply + 2)
+                acc_stack.resize(ply + 2);
+            eval.update(acc_stack[ply], mtx[turn.x][turn.y], turn.xb != -1 ? mtx[turn.xb][turn.yb] : 0, turn,
+                        acc_stack[ply + 1]);
+        }
+        ++ply;
+        return make_turn(mtx, turn);
+    }
 
-            // оценка получившейся позиции
-            double score = calc_score(new_mtx, color);
+    // возврат на предыдущий уровень поиска
+    void leave_turn()
+    {
+        --ply;
+    }
 
-            // обновление лучшей оценки
-            if (alpha == -1 || score > best_score)
-            {
-                best_score = score;
-            }
-        }
+    // ход turn стал лучшим на текущем уровне: главный вариант уровня - этот ход и вариант следующего уровня
+    void update_pv(const move_pos &turn)
+    {
+        if (pv_table.size() < ply + 2)
+            pv_table.resize(ply + 2);
+        vector<move_pos> &line = pv_table[ply];
+        line.assign(1, turn);
+        line.insert(line.end(), pv_table[ply + 1].begin(), pv_table[ply + 1].end());
+    }
 
-        return best_score;
+    // сброс главного варианта текущего уровня при входе в узел
+    void clear_pv()
+    {
+        if (pv_table.size() < ply + 2)
+            pv_table.resize(ply + 2);
+        pv_table[ply].clear();
+        pv_table[ply + 1].clear();
     }
 
-    // объявление рекурсивной функции поиска лучших ходов
-    double find_best_turns_rec(vector<vector<POS_T>> mtx, const bool color, const size_t depth, double alpha,
-                               double beta, const POS_T x, const POS_T y)
+    // запись таблицы: своя таблица, затем общая, замороженная на время задач детерминированного поиска
+    bool probe(const uint64_t key, tt_entry &entry) const
     {
-        // базовый случай - достигнута максимальная глубина
-        if (depth == 0)
-        {
-            return calc_score(mtx, !color); // оценка с точки зрения противника
-        }
+        return tt->probe(key, entry) || (frozen_tt && frozen_tt->probe(key, entry));
+    }
 
-        // поиск всех возможных ходов для текущего цвета
-        find_turns(color, mtx);
+    // таблица транспозиций используется только в узлах начала хода и с упорядочиванием ходов
+    bool use_tt() const
+    {
+        return tt && tt->enabled() && optimization != optimization_level::O0;
+    }
 
-        // если нет ходов то игра окончена
-        if (turns.empty())
-        {
-            return calc_score(mtx, !color);
-        }
+    // ключ позиции в таблице транспозиций для поиска бота bot_color
+    uint64_t tt_key(const vector<vector<POS_T>> &mtx, const bool color, const bool bot_color) const
+    {
+        return zobrist::key(packed_pos(mtx), color) ^ tt_salt[bot_color];
+    }
 
-        // если это ход бота
-        if (color == board->get_board()[0][0] % 2) // предполагаем, что первый ход делает бот
-        {
-            double max_eval = 0;
+    // правила ничьей в поиске: узлы начала хода записываются в историю пути
+    bool draw_rules() const
+    {
+        return repetition_draw || no_progress_plies;
+    }
 
-            // перебор всех возможных ходов
-            for (const auto &turn : turns)
-            {
-                // выполнение хода на копии доски
-                vector<vector<POS_T>> new_mtx = make_turn(mtx, turn);
+    // переход между оценкой для бота и оценкой для противника (INF и 0 меняются местами)
+    static double flip_score(const double score)
+    {
+        if (score >= INF)
+            return 0;
+        if (score <= 0)
+            return INF;
+        return 1 / score;
+    }
 
-                // рекурсивный вызов для противника
-                double eval = find_best_turns_rec(new_mtx, !color, depth - 1, alpha, beta);
+    // проверка таблицы: оценка позиции, если записи достаточно, иначе сужение окна (alpha, beta).
+    // в таблице оценка для ходящей стороны, в поиске - для бота
+    bool probe_tt(const uint64_t key, const size_t remaining, const bool is_bot_turn, double &alpha, double &beta,
+                  double &score, tt_entry &entry) const
+    {
+        if (!probe(key, entry) || entry.depth < remaining)
+            return false;
+        score = is_bot_turn ? entry.score : flip_score(entry.score);
+        tt_bound bound = entry.bound;
+        if (!is_bot_turn && bound != TT_EXACT)
+            bound = (bound == TT_LOWER ? TT_UPPER : TT_LOWER);
+        if (bound == TT_EXACT)
+            return true;
+        if (bound == TT_LOWER)
+            alpha = max(alpha, score);
+        else
+            beta = min(beta, score);
+        return alpha >= beta;
+    }
 
-                // обновление максимальной оценки
-                max_eval = max(max_eval, eval);
-                alpha = max(alpha, eval);
+    // запись оценки score, полученной в окне (alpha, beta), и лучшего хода
+    void store_tt(const uint64_t key, const size_t remaining, const bool is_bot_turn, const double score,
+                  const double alpha, const double beta, const move_pos &best)
+    {
+        tt_entry entry;
+        entry.score = float(is_bot_turn ? score : flip_score(score));
+        entry.depth = uint8_t(min<size_t>(remaining, 255));
+        entry.bound = score <= alpha ? TT_UPPER : score >= beta ? TT_LOWER : TT_EXACT;
+        if (!is_bot_turn && entry.bound != TT_EXACT)
+            entry.bound = (entry.bound == TT_LOWER ? TT_UPPER : TT_LOWER);
+        entry.from = int8_t(packed_pos::square(best.x, best.y));
+        entry.to = int8_t(packed_pos::square(best.x2, best.y2));
+        tt->store(key, entry);
+        if (frozen_tt)
+            tt_log.emplace_back(key, entry);
+    }
 
-                // альфабета отсечение
-                if (optimization != "None" && beta <= alpha)
-                {
-                    break;
-                }
+    // лучший ход из таблицы переносится в начало списка, порядок остальных сохраняется
+    static void tt_move_first(move_list &turns_now, const tt_entry &entry)
+    {
+        for (size_t i = 1; i < turns_now.size(); ++i)
+        {
+            const move_pos &turn = turns_now[i];
+            if (packed_pos::square(turn.x, turn.y) == entry.from && packed_pos::square(turn.x2, turn.y2) == entry.to)
+            {
+                rotate(turns_now.begin(), turns_now.begin() + i, turns_now.begin() + i + 1);
+                return;
             }
+        }
+    }
 
-            return max_eval;
+    // упорядочивание ходов по оценке получающихся позиций: сначала лучшие для ходящей стороны.
+    // все дочерние позиции оцениваются одним пакетом, а оценка с аккумулятором - от аккумулятора узла,
+    // одним обновлением на ход вместо пересчета каждой дочерней позиции
+    void order_turns(const vector<vector<POS_T>> &mtx, move_list &turns_now, const bool bot_color,
+                     const bool is_bot_turn)
+    {
+        if (optimization == optimization_level::O0 || turns_now.size() < 2)
+            return;
+        const packed_pos pos(mtx);
+        const Evaluator &eval = *evaluators[bot_color];
+        order_scores.resize(turns_now.size());
+        if (eval.incremental())
+        {
+            eval_acc child;
+            for (size_t i = 0; i < turns_now.size(); ++i)
+            {
+                const move_pos &turn = turns_now[i];
+                eval.update(acc_stack[ply], mtx[turn.x][turn.y], turn.xb != -1 ? mtx[turn.xb][turn.yb] : 0, turn,
+                            child);
+                order_scores[i] = eval.score(child, pos.make_turn(turn), bot_color);
+            }
         }
         else
         {
-            // ход противника
-            double min_eval = INF;
-
-            // перебор всех возможных ходов противника
-            for (const auto &turn : turns)
+            order_batch.clear();
+            for (const auto &turn : turns_now)
             {
-                // выполнение хода на копии доски
-                vector<vector<POS_T>> new_mtx = make_turn(mtx, turn);
-
-                // рекурсивный вызов для бота
-                double eval = find_best_turns_rec(new_mtx, !color, depth - 1, alpha, beta);
-
-                // обновление минимальной оценки
-                min_eval = min(min_eval, eval);
-                beta = min(beta, eval);
-
-                // альфа-бета отсечение
-                if (optimization != "None" && beta <= alpha)
-                {
-                    break;
-                }
+                order_batch.push(pos.make_turn(turn));
             }
-
-            return min_eval;
+            eval.score(order_batch, bot_color, order_scores.data());
+        }
+        // сортировка вставками: ходов немного, а порядок равных (после перемешивания) сохраняется
+        for (size_t i = 1; i < turns_now.size(); ++i)
+        {
+            const double score = order_scores[i];
+            const move_pos turn = turns_now[i];
+            size_t j = i;
+            while (j > 0 && (is_bot_turn ? order_scores[j - 1] < score : order_scores[j - 1] > score))
+            {
+                order_scores[j] = order_scores[j - 1];
+                turns_now[j] = turns_now[j - 1];
+                --j;
+            }
+            order_scores[j] = score;
+            turns_now[j] = turn;
         }
     }
 
-public:
-    // поиск всех возможных ходов для указанного цвета
-    void find_turns(const bool color)
+    // futility pruning: у горизонта спокойный узел, статическая оценка которого с запасом хуже окна,
+    // не ищется - ходом стороны положение так не исправить
+    bool futility_cut(const vector<vector<POS_T>> &mtx, const bool color, const size_t depth, const size_t remaining,
+                      const double alpha, const double beta, double &score) const
     {
-        find_turns(color, board->get_board());
+        if (!selective.futility || remaining > selective.futility_depth || optimization == optimization_level::O0)
+            return false;
+        const double margin = pow(selective.futility_margin, double(remaining));
+        const double static_score = calc_score(mtx, depth % 2 == color);
+        score = depth % 2 ? static_score * margin : static_score / margin;
+        return depth % 2 ? score <= alpha : score >= beta;
     }
 
-    // поиск возможных ходов для фигуры в указанной позиции
-    void find_turns(const POS_T x, const POS_T y)
+    // ProbCut: узел ищется на probcut_reduction полуходов мельче с окном, сдвинутым на запас за границу;
+    // если и такой поиск выходит за границу, полный поиск узла почти наверняка тоже даст отсечение
+    bool probcut(const vector<vector<POS_T>> &mtx, const bool color, const size_t depth, const size_t remaining,
+                 const double alpha, const double beta, double &score)
     {
-        find_turns(x, y, board->get_board());
+        if (!selective.probcut || remaining < selective.probcut_depth || optimization == optimization_level::O0)
+            return false;
+        // ход бота - отсечение сверху по beta, ход противника - снизу по alpha
+        const double bound = depth % 2 ? beta * selective.probcut_margin : alpha / selective.probcut_margin;
+        if (depth % 2 ? bound >= INF : alpha <= 0)
+            return false;
+        reduced += selective.probcut_reduction;
+        score = depth % 2 ? find_best_turns_node(mtx, color, depth, bound, INF + 1)
+                          : find_best_turns_node(mtx, color, depth, -1, bound);
+        reduced -= selective.probcut_reduction;
+        if (aborted || (depth % 2 ? score > bound : score < bound))
+            return true;
+        // неглубокий поиск занял список ходов и главный вариант уровня
+        clear_pv();
+        gen_turns(color, mtx, move_stack[ply]);
+        return false;
     }
 
-private:
-    // поиск всех возможных ходов для указанного цвета на данной доске
-    void find_turns(const bool color, const vector<vector<POS_T>> &mtx)
+    // сокращение глубины хода number спокойного узла (late move reductions): первые ходы, превращения в дамку
+    // и узлы без границы окна со стороны ходящего ищутся полностью
+    size_t lmr_reduction(const vector<vector<POS_T>> &mtx, const move_pos &turn, const size_t number,
+                         const size_t remaining, const bool is_bot_turn, const double alpha, const double beta) const
+    {
+        if (!selective.lmr || number < selective.lmr_moves || remaining < selective.lmr_depth ||
+            optimization == optimization_level::O0)
+            return 0;
+        if (is_bot_turn ? alpha < 0 : beta > INF)
+            return 0;
+        const POS_T type = mtx[turn.x][turn.y];
+        if ((type == 1 && turn.x2 == 0) || (type == 2 && turn.x2 == geometry8::size - 1))
+            return 0;
+        return selective.lmr_reduction;
+    }
+
+    // поиск лучшего первого хода бота (вместе с продолжением серии боя),
+    // state - номер состояния в цепочке next_move/next_best_state
+    double find_first_best_turn(vector<vector<POS_T>> mtx, const bool color, const POS_T x, const POS_T y, size_t state,
+                                double alpha = -1)
     {
-        vector<move_pos> res_turns;
-        bool have_beats_before = false;
-        // перебор всех клеток доски
-        for (POS_T i = 0; i < 8; ++i)
+        next_best_state.push_back(-1);
+        next_move.emplace_back(-1, -1, -1, -1);
+        clear_pv();
+        double best_score = -1;
+        // поиск ходов: всех для цвета в начале или продолжений боя для фигуры
+        move_list &turns_now = move_stack[ply];
+        if (state != 0)
+        {
+            turns_now.clear();
+            rules::piece_turns(x, y, mtx, turns_now);
+        }
+        else
+            gen_turns(color, mtx, turns_now);
+        const bool have_beats_now = turns_now.have_beats;
+
+        // серия боя закончилась - ход переходит к противнику
+        if (!have_beats_now && state != 0)
+        {
+            return find_best_turns_rec(mtx, !color, 0, alpha);
+        }
+        order_turns(mtx, turns_now, color, true);
+        // в корне таблица дает лучший ход предыдущей итерации углубления
+        uint64_t key = 0;
+        tt_entry entry;
+        if (state == 0 && use_tt())
+        {
+            key = tt_key(mtx, color, color);
+            if (probe(key, entry))
+                tt_move_first(turns_now, entry);
+        }
+        if (state == 0)
+        {
+            if (multi_pv > 1)
+                lines_first(turns_now);
+            root_lines.clear();
+        }
+
+        if (state == 0 && turns_now.size() > 1 && (threads > 1 || deterministic))
         {
-            for (POS_T j = 0; j < 8; ++j)
+            best_score = parallel_root(mtx, color, turns_now, have_beats_now);
+            if (use_tt() && best_score >= 0 && !aborted)
+                store_tt(key, Max_depth + 1, true, best_score, -1, INF + 1, next_move[0]);
+            return best_score;
+        }
+
+        for (auto turn : turns_now)
+        {
+            size_t next_state = next_move.size();
+            // в корне окно - оценка multi_pv-го лучшего хода: с одним вариантом это лучшая оценка
+            const double window = state == 0 ? lines_bound(root_lines) : best_score;
+            double score;
+            if (have_beats_now)
+            {
+                score = find_first_best_turn(enter_turn(mtx, turn, color), color, turn.x2, turn.y2, next_state,
+                                             window);
+            }
+            else
+            {
+                score = find_best_turns_rec(enter_turn(mtx, turn, color), !color, 0, window);
+            }
+            leave_turn();
+            // прерванный ход не сравнивается с досчитанными
+            if (aborted)
+                break;
+            // точная оценка хода корня - новый вариант
+            if (state == 0 && score > window)
             {
-                // проверка фигур нужного цвета
-                if (mtx[i][j] && mtx[i][j] % 2 != color)
+                root_line line{score, {turn}, {turn}};
+                if (have_beats_now && next_move[next_state].x != -1)
                 {
-                    find_turns(i, j, mtx);
-                    // приоритет ходов с боем
-                    if (have_beats && !have_beats_before)
-                    {
-                        have_beats_before = true;
-                        res_turns.clear();
-                    }
-                    // добавление ходов (только бои или только обычные)
-                    if ((have_beats_before && have_beats) || !have_beats_before)
-                    {
-                        res_turns.insert(res_turns.end(), turns.begin(), turns.end());
-                    }
+                    const auto rest = best_series(int(next_state));
+                    line.series.insert(line.series.end(), rest.begin(), rest.end());
                 }
+                line.pv.insert(line.pv.end(), pv_table[ply + 1].begin(), pv_table[ply + 1].end());
+                add_line(root_lines, move(line));
+            }
+            // обновление лучшего результата
+            if (score > best_score)
+            {
+                best_score = score;
+                next_best_state[state] = (have_beats_now ? int(next_state) : -1);
+                next_move[state] = turn;
+                update_pv(turn);
             }
         }
-        turns = res_turns;
-        // перемешивание ходов для случайности
-        shuffle(turns.begin(), turns.end(), rand_eng);
-        have_beats = have_beats_before;
+        if (state == 0 && aborted)
+        {
+            // ни один ход корня не досчитан
+            if (best_score < 0)
+                set_first_series(mtx, turns_now[0]);
+            return best_score;
+        }
+        if (state == 0 && use_tt() && best_score >= 0)
+            store_tt(key, Max_depth + 1, true, best_score, -1, INF + 1, next_move[0]);
+        return best_score;
     }
 
-    // поиск возможных ходов для фигуры в указанной позиции на данной доске
-    void find_turns(const POS_T x, const POS_T y, const vector<vector<POS_T>> &mtx)
+    // рекурсивный поиск оценки позиции минимаксом с альфа-бета отсечением,
+    // на нечетной глубине ходит бот, (x, y) - фигура, продолжающая серию боя.
+    // позиция начала хода лежит в истории пути, пока ищется узел: повторение или ходы без продвижения - ничья
+    double find_best_turns_rec(vector<vector<POS_T>> mtx, const bool color, const size_t depth,
+                               const double alpha = -1, const double beta = INF + 1, const POS_T x = -1,
+                               const POS_T y = -1)
+    {
+        if (x != -1 || !draw_rules())
+            return find_best_turns_node(move(mtx), color, depth, alpha, beta, x, y);
+        history.push(packed_pos(mtx), color);
+        double score = draw_score;
+        if (!history.is_draw(repetition_draw, no_progress_plies, path_start))
+            score = find_best_turns_node(move(mtx), color, depth, alpha, beta);
+        else
+            clear_pv();
+        history.pop();
+        return score;
+    }
+
+    // узел поиска find_best_turns_rec без проверки ничьей (ProbCut ищет тот же узел еще раз)
+    double find_best_turns_node(vector<vector<POS_T>> mtx, const bool color, const size_t depth, double alpha = -1,
+                                double beta = INF + 1, const POS_T x = -1, const POS_T y = -1)
     {
-        turns.clear();
-        have_beats = false;
-        POS_T type = mtx[x][y];
-        // поиск ходов с боем
-        switch (type)
+        clear_pv();
+        bool tt_node = false;
+        uint64_t key = 0;
+        tt_entry entry;
+        // оставшаяся глубина с учетом сокращений ветки (на четность depth, то есть на очередь хода, не влияют)
+        const size_t remaining = depth + reduced < Max_depth ? Max_depth - depth - reduced : 0;
+        // ходы уровня пишутся в его заранее выделенный список
+        move_list &turns_now = move_stack[ply];
+        // базовый случай - достигнута максимальная глубина
+        if (remaining == 0 && x == -1)
         {
-        case 1:
-        case 2:
-            // проверка боя для обычных шашек
-            for (POS_T i = x - 2; i <= x + 2; i += 4)
+            // упакованная позиция узла уже есть в истории пути
+            const packed_pos pos = draw_rules() ? history.top_pos() : packed_pos(mtx);
+            if (quiescence_nodes == 0)
+                return calc_score(pos, (depth % 2 == color));
+            // за горизонтом продолжаются только обязательные взятия, спокойная позиция оценивается сразу
+            gen_turns(color, mtx, turns_now);
+            if (!turns_now.have_beats || qnodes >= quiescence_nodes)
             {
-                for (POS_T j = y - 2; j <= y + 2; j += 4)
-                {
-                    if (i < 0 || i > 7 || j < 0 || j > 7)
-                        continue;
-                    POS_T xb = (x + i) / 2, yb = (y + j) / 2;
-                    // проверка возможности съесть фигуру
-                    if (mtx[i][j] || !mtx[xb][yb] || mtx[xb][yb] % 2 == type % 2)
-                        continue;
-                    turns.emplace_back(x, y, i, j, xb, yb);
-                }
+                qcut += turns_now.have_beats;
+                return calc_score(pos, (depth % 2 == color));
             }
-            break;
-        default:
-            // проверка боя для дамок
-            for (POS_T i = -1; i <= 1; i += 2)
+            ++qnodes;
+        }
+        // поиск ходов: всех или продолжений серии боя
+        else if (x != -1)
+        {
+            turns_now.clear();
+            rules::piece_turns(x, y, mtx, turns_now);
+        }
+        else
+        {
+            // оценка или сужение окна по таблице транспозиций
+            if (use_tt())
             {
-                for (POS_T j = -1; j <= 1; j += 2)
-                {
-                    POS_T xb = -1, yb = -1;
-                    // движение по диагонали до препятствия
-                    for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
-                    {
-                        if (mtx[i2][j2])
-                        {
-                            // остановка при встрече своей фигуры или второй чужой
-                            if (mtx[i2][j2] % 2 == type % 2 || (mtx[i2][j2] % 2 != type % 2 && xb != -1))
-                            {
-                                break;
-                            }
-                            xb = i2;
-                            yb = j2;
-                        }
-                        // добавление хода с боем
-                        if (xb != -1 && xb != i2)
-                        {
-                            turns.emplace_back(x, y, i2, j2, xb, yb);
-                        }
-                    }
-                }
+                tt_node = true;
+                // ключ позиции уже посчитан для истории пути
+                key = draw_rules() ? history.top_key() ^ tt_salt[depth % 2 == color]
+                                   : tt_key(mtx, color, depth % 2 == color);
+                double score;
+                if (probe_tt(key, remaining, depth % 2, alpha, beta, score, entry))
+                    return score;
             }
-            break;
+            gen_turns(color, mtx, turns_now);
+            // отсечения выборочного поиска только в спокойных узлах: обязательные взятия ищутся полностью
+            double score;
+            if (!turns_now.have_beats && !turns_now.empty() &&
+                (futility_cut(mtx, color, depth, remaining, alpha, beta, score) ||
+                 probcut(mtx, color, depth, remaining, alpha, beta, score)))
+                return score;
         }
-        // поиск обычных ходов если нет боев
-        if (!turns.empty())
+        const bool have_beats_now = turns_now.have_beats;
+
+        // серия боя закончилась - ход переходит к другому цвету
+        if (!have_beats_now && x != -1)
         {
-            have_beats = true;
-            return;
+            return find_best_turns_rec(mtx, !color, depth + 1, alpha, beta);
         }
-        switch (type)
+
+        // если нет ходов то игра окончена
+        if (turns_now.empty())
+            return (depth % 2 ? 0 : INF);
+        const bool bot_color = (depth % 2 == color);
+        order_turns(mtx, turns_now, bot_color, depth % 2);
+        if (tt_node)
+            tt_move_first(turns_now, entry);
+
+        const double alpha_start = alpha, beta_start = beta;
+        double min_score = INF + 1;
+        double max_score = -1;
+        move_pos best_turn = turns_now[0];
+        for (size_t i = 0; i < turns_now.size(); ++i)
         {
-        case 1:
-        case 2:
-            // обычные ходы для шашек
+            const move_pos turn = turns_now[i];
+            double score;
+            if (!have_beats_now && x == -1)
             {
-                POS_T i = ((type % 2) ? x - 1 : x + 1);
-                for (POS_T j = y - 1; j <= y + 1; j += 2)
+                // поздний спокойный ход сначала ищется с сокращенной глубиной,
+                // и полностью - только если он улучшает окно
+                const size_t reduction = lmr_reduction(mtx, turn, i, remaining, depth % 2, alpha, beta);
+                reduced += reduction;
+                score = find_best_turns_rec(enter_turn(mtx, turn, bot_color), !color, depth + 1, alpha, beta);
+                leave_turn();
+                reduced -= reduction;
+                if (reduction && !aborted && (depth % 2 ? score > alpha : score < beta))
                 {
-                    if (i < 0 || i > 7 || j < 0 || j > 7 || mtx[i][j])
-                        continue;
-                    turns.emplace_back(x, y, i, j);
+                    score = find_best_turns_rec(enter_turn(mtx, turn, bot_color), !color, depth + 1, alpha, beta);
+                    leave_turn();
                 }
-                break;
             }
-        default:
-            // обычные ходы для дамок
-            for (POS_T i = -1; i <= 1; i += 2)
+            else
             {
-                for (POS_T j = -1; j <= 1; j += 2)
-                {
-                    // движение по диагонали до препятствия
-                    for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
-                    {
-                        if (mtx[i2][j2])
-                            break;
-                        turns.emplace_back(x, y, i2, j2);
-                    }
-                }
+                score = find_best_turns_rec(enter_turn(mtx, turn, bot_color), color, depth, alpha, beta, turn.x2,
+                                            turn.y2);
+                leave_turn();
             }
-            break;
+            // поиск прерван: оценка неполная и не записывается в таблицу
+            if (aborted)
+                return (depth % 2 ? max_score : min_score);
+            if (depth % 2 ? score > max_score : score < min_score)
+            {
+                best_turn = turn;
+                update_pv(turn);
+            }
+            min_score = min(min_score, score);
+            max_score = max(max_score, score);
+            // альфа-бета отсечение
+            if (depth % 2)
+                alpha = max(alpha, max_score);
+            else
+                beta = min(beta, min_score);
+            if (optimization != optimization_level::O0 && alpha >= beta)
+                break;
         }
+        if (tt_node)
+            store_tt(key, remaining, depth % 2, depth % 2 ? max_score : min_score, alpha_start, beta_start, best_turn);
+        return (depth % 2 ? max_score : min_score);
+    }
+
+public:
+    // поиск всех возможных ходов для указанного цвета на данной доске (в turns и have_beats)
+    void find_turns(const bool color, const vector<vector<POS_T>> &mtx)
+    {
+        move_list list;
+        gen_turns(color, mtx, list);
+        turns.assign(list.begin(), list.end());
+        have_beats = list.have_beats;
+    }
+
+    // поиск возможных ходов для фигуры в указанной позиции на данной доске
+    void find_turns(const POS_T x, const POS_T y, const vector<vector<POS_T>> &mtx)
+    {
+        move_list list;
+        rules::piece_turns(x, y, mtx, list);
+        turns.assign(list.begin(), list.end());
+        have_beats = list.have_beats;
+    }
+
+private:
+    // все ходы цвета color в list: только ходы с боем, если они есть
+    void gen_turns(const bool color, const vector<vector<POS_T>> &mtx, move_list &list)
+    {
+        rules::side_turns(color, mtx, list);
+        // перемешивание ходов для случайности
+        shuffle(list.begin(), list.end(), rand_eng);
     }
 
 public:
-    vector<move_pos> turns; // список возможных ходов
-    bool have_beats;        // есть ли ходы с боем
-    int Max_depth;          // максимальная глубина поиска для бота
+    position_history history;           // позиции партии до корня и пути поиска (для правил ничьей)
+    vector<move_pos> turns;             // список возможных ходов
+    bool have_beats;                    // есть ли ходы с боем
+    size_t Max_depth;                   // максимальная глубина поиска для бота
+    double last_score = 0;              // оценка лучшего хода в последнем поиске (для бота)
+    size_t nodes = 0;                   // выполненные ходы (узлы) в последнем поиске
+    size_t qnodes = 0;                  // узлы со взятиями за горизонтом в последнем поиске
+    size_t qcut = 0;                    // листья, оцененные без продолжения взятий из-за лимита узлов
+    size_t Max_nodes = 0;               // лимит узлов поиска (0 - без лимита)
+    const atomic<bool> *stop = nullptr; // внешний флаг остановки поиска (nullptr - нет)
+    // срок окончания поиска, прерывает и текущую итерацию (по умолчанию - без срока)
+    chrono::steady_clock::time_point deadline{};
+    bool aborted = false;               // последний поиск прерван лимитом узлов, памяти, сроком или флагом остановки
+    size_t multi_pv = 1;                // число лучших ходов корня с точными оценками (lines)
 
 private:
-    default_random_engine rand_eng; // генератор случайных чисел
-    string scoring_mode;            // режим оценки позиции
-    string optimization;            // уровень оптимизации алгоритма
-    vector<move_pos> next_move;     // следующие ходы в лучшей последовательности
-    vector<int> next_best_state;    // индексы лучших состояний
-    Board *board;                   // указатель на игровую доску
-    Config *config;                 // указатель на конфигурацию
+    default_random_engine rand_eng;              // генератор случайных чисел
+    optimization_level optimization;             // уровень оптимизации алгоритма
+    size_t quiescence_nodes;                     // лимит узлов продолжения взятий за горизонтом (0 - выключено)
+    selective_settings selective;                // сокращения и отсечения выборочного поиска
+    size_t reduced = 0;                          // сокращение глубины текущей ветки (LMR, ProbCut)
+    size_t repetition_draw = 3;                  // ничья при таком повторении позиции (0 - нет)
+    size_t no_progress_plies = 30;               // ничья после стольких обратимых полуходов (0 - нет)
+    size_t path_start = 0;                       // номер корня поиска в истории
+    static constexpr double draw_score = 1;      // оценка ничьей: силы равны
+    vector<move_pos> next_move;                  // следующие ходы в лучшей последовательности
+    vector<int> next_best_state;                 // индексы лучших состояний
+    shared_ptr<const Evaluator> evaluators[2];   // оценки позиции белого и черного ботов
+    pos_batch order_batch;                       // буфер дочерних позиций для упорядочивания
+    vector<eval_acc> acc_stack;                  // аккумуляторы оценки по уровням поиска
+    vector<move_list> move_stack;                // списки ходов по уровням поиска
+    vector<vector<move_pos>> pv_table;           // главные варианты по уровням поиска
+    vector<root_line> root_lines;                // лучшие ходы корня последнего поиска
+    uint64_t root_key = 0;                       // позиция корня root_lines
+    size_t ply = 0;                              // текущий уровень поиска (с учетом взятий в серии)
+    vector<double> order_scores;                 // оценки дочерних позиций
+    uint64_t tt_salt[2];                         // добавки к ключам таблицы для белого и черного ботов
+    Config *config;                              // указатель на конфигурацию
+    shared_ptr<const settings> current;          // снимок настроек, с которым работает поиск
+    Transposition *tt;                           // таблица транспозиций (nullptr - без таблицы)
+    const Transposition *frozen_tt = nullptr;    // общая таблица, только для чтения (задачи детерминированного поиска)
+    shared_ptr<Transposition> local_tt;          // своя таблица задачи детерминированного поиска
+    size_t threads = 1;                          // потоки поиска корня
+    bool deterministic = false;                  // результат не зависит от числа потоков и времени
+    vector<Logic> helpers;                       // вспомогательные поиски потоков корня
+    vector<pair<uint64_t, tt_entry>> tt_log;     // записи своей таблицы задачи для переноса в общую
+    size_t max_memory_mb = 0;                    // лимит памяти поиска в МБ (0 - без лимита)
+    shared_ptr<search_budget> budget;            // ограничения текущего поиска
+    size_t reported_memory = 0;                  // память этого поиска, уже учтенная в бюджете
+    static constexpr size_t budget_check = 1024; // период проверки ограничений в узлах (степень двойки)
+    static constexpr size_t max_captures = 24;   // взятий на одном пути поиска не больше числа фигур
+    static constexpr size_t ply_bytes = 1024;    // оценка памяти одного уровня рекурсии: копии доски
 };
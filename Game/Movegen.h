@@ -0,0 +1,139 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+
+#include "../Models/Geometry.h"
+#include "../Models/Move.h"
+
+using namespace std;
+
+// правила ходов на доске G (русские шашки): шашки бьют назад и вперед, дамки ходят и бьют на любое расстояние,
+// взятие обязательно. доска - матрица G::size x G::size, все размеры и таблицы лучей известны при компиляции
+template <class G> struct movegen
+{
+    typedef move_list_of<G> list_t;
+
+    // все ходы цвета color в list: только ходы с боем, если они есть
+    static void side_turns(const bool color, const vector<vector<POS_T>> &mtx, list_t &list)
+    {
+        list.clear();
+        // перебор черных клеток доски
+        for (POS_T i = 0; i < G::size; ++i)
+        {
+            for (POS_T j = (i + 1) % 2; j < G::size; j += 2)
+            {
+                // проверка фигур нужного цвета
+                if (mtx[i][j] && mtx[i][j] % 2 != color)
+                    piece_turns(i, j, mtx, list);
+            }
+        }
+    }
+
+    // ходы фигуры (x, y), дописываемые в list. первые ходы с боем вытесняют из списка обычные ходы,
+    // после них обычные ходы фигур уже не ищутся. клетки берутся из таблиц лучей без проверок границ
+    static void piece_turns(const POS_T x, const POS_T y, const vector<vector<POS_T>> &mtx, list_t &list)
+    {
+        constexpr const board_rays<G> &R = rays_of<G>;
+        const size_t start = list.count;
+        const int s = G::square(x, y);
+        const POS_T type = mtx[x][y];
+        // поиск ходов с боем
+        switch (type)
+        {
+        case 1:
+        case 2:
+            // проверка боя для обычных шашек: соседняя клетка луча - съедаемая фигура, следующая - куда встать
+            for (int d = 0; d < 4; ++d)
+            {
+                if (R.ray_len[s][d] < 2)
+                    continue;
+                const cell_pos b = R.ray[s][d][0], to = R.ray[s][d][1];
+                // проверка возможности съесть фигуру
+                if (mtx[to.i][to.j] || !mtx[b.i][b.j] || mtx[b.i][b.j] % 2 == type % 2)
+                    continue;
+                list.push(move_pos(x, y, to.i, to.j, b.i, b.j));
+            }
+            break;
+        default:
+            // проверка боя для дамок
+            for (int d = 0; d < 4; ++d)
+            {
+                const cell_pos *ray = R.ray[s][d];
+                POS_T xb = -1, yb = -1;
+                // движение по диагонали до препятствия
+                for (int k = 0; k < R.ray_len[s][d]; ++k)
+                {
+                    const POS_T piece = mtx[ray[k].i][ray[k].j];
+                    if (piece)
+                    {
+                        // остановка при встрече своей фигуры или второй чужой
+                        if (piece % 2 == type % 2 || xb != -1)
+                            break;
+                        xb = ray[k].i;
+                        yb = ray[k].j;
+                    }
+                    // добавление хода с боем
+                    else if (xb != -1)
+                    {
+                        list.push(move_pos(x, y, ray[k].i, ray[k].j, xb, yb));
+                    }
+                }
+            }
+            break;
+        }
+        if (list.count > start)
+        {
+            // первые ходы с боем: обычные ходы других фигур отбрасываются
+            if (!list.have_beats)
+            {
+                copy(list.begin() + start, list.end(), list.begin());
+                list.count -= start;
+                list.have_beats = true;
+            }
+            return;
+        }
+        // поиск обычных ходов если нет боев
+        if (list.have_beats)
+            return;
+        switch (type)
+        {
+        case 1:
+        case 2:
+            // обычные ходы для шашек: белые ходят вверх (направления 0, 1), черные вниз (2, 3)
+            for (int d = (type % 2 ? 0 : 2), end = d + 2; d < end; ++d)
+            {
+                if (R.ray_len[s][d] == 0)
+                    continue;
+                const cell_pos to = R.ray[s][d][0];
+                if (!mtx[to.i][to.j])
+                    list.push(move_pos(x, y, to.i, to.j));
+            }
+            break;
+        default:
+            // обычные ходы для дамок
+            for (int d = 0; d < 4; ++d)
+            {
+                const cell_pos *ray = R.ray[s][d];
+                // движение по диагонали до препятствия
+                for (int k = 0; k < R.ray_len[s][d] && !mtx[ray[k].i][ray[k].j]; ++k)
+                    list.push(move_pos(x, y, ray[k].i, ray[k].j));
+            }
+            break;
+        }
+    }
+
+    // выполнение хода на копии доски
+    static vector<vector<POS_T>> make_turn(vector<vector<POS_T>> mtx, const move_pos &turn)
+    {
+        // удаление съеденной фигуры
+        if (turn.xb != -1)
+            mtx[turn.xb][turn.yb] = 0;
+        // превращение в дамку при достижении края
+        if ((mtx[turn.x][turn.y] == 1 && turn.x2 == 0) || (mtx[turn.x][turn.y] == 2 && turn.x2 == G::size - 1))
+            mtx[turn.x][turn.y] += 2;
+        // перемещение фигуры
+        mtx[turn.x2][turn.y2] = mtx[turn.x][turn.y];
+        mtx[turn.x][turn.y] = 0;
+        return mtx;
+    }
+};
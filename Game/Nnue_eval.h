@@ -0,0 +1,241 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "Evaluator.h"
+
+using namespace std;
+
+// размеры сети: 128 входов (4 типа фигур x 32 клетки) -> 64 -> 16 -> 1
+const int NNUE_INPUTS = 128;
+const int NNUE_L1 = 64;
+const int NNUE_L2 = 16;
+// масштабы квантования: активации в [0, 127], веса второго и третьего слоев с шагом 1/64
+const int NNUE_QA = 127;
+const int NNUE_QB = 64;
+
+// квантованные веса сети, обучаются Tools/nnue_trainer.cpp
+struct nnue_net
+{
+    alignas(32) int16_t w1[NNUE_INPUTS][NNUE_L1]; // первый слой, строка на каждый вход
+    alignas(32) int16_t b1[NNUE_L1];
+    alignas(32) int8_t w2[NNUE_L2][NNUE_L1];
+    int32_t b2[NNUE_L2];
+    int16_t w3[NNUE_L2];
+    int32_t b3;
+
+    // номер входа для фигуры piece (1-4) на клетке с битом square
+    static int feature(const POS_T piece, const int square)
+    {
+        return (piece - 1) * 32 + square;
+    }
+
+    bool load(const string &path)
+    {
+        ifstream fin(path, ios_base::binary);
+        char magic[4];
+        if (!fin.read(magic, 4) || memcmp(magic, "CNN1", 4) != 0)
+            return false;
+        return bool(fin.read((char *)w1, sizeof(w1)).read((char *)b1, sizeof(b1)).read((char *)w2, sizeof(w2))
+                        .read((char *)b2, sizeof(b2)).read((char *)w3, sizeof(w3)).read((char *)&b3, sizeof(b3)));
+    }
+
+    void save(const string &path) const
+    {
+        ofstream fout(path, ios_base::binary);
+        fout.write("CNN1", 4);
+        fout.write((const char *)w1, sizeof(w1)).write((const char *)b1, sizeof(b1));
+        fout.write((const char *)w2, sizeof(w2)).write((const char *)b2, sizeof(b2));
+        fout.write((const char *)w3, sizeof(w3)).write((const char *)&b3, sizeof(b3));
+    }
+};
+
+// оценка небольшой нейросетью (NNUE): выход - логарифм отношения сил белых к силам черных.
+// аккумулятор первого слоя обновляется при каждом ходе, вывод - целочисленный (AVX2 или скалярный)
+class Nnue_eval : public Evaluator
+{
+public:
+    Nnue_eval(const string &path)
+    {
+        if (!net.load(path))
+            throw runtime_error("can't load NNUE weights from " + path);
+        // поля по отдельности: выравнивание оставляет между ними неинициализированные байты
+        net_hash = hash_bytes("NNUE", 4);
+        net_hash = hash_bytes(net.w1, sizeof(net.w1), net_hash);
+        net_hash = hash_bytes(net.b1, sizeof(net.b1), net_hash);
+        net_hash = hash_bytes(net.w2, sizeof(net.w2), net_hash);
+        net_hash = hash_bytes(net.b2, sizeof(net.b2), net_hash);
+        net_hash = hash_bytes(net.w3, sizeof(net.w3), net_hash);
+        net_hash = hash_bytes(&net.b3, sizeof(net.b3), net_hash);
+#ifdef CHECKERS_X86_SIMD
+        __builtin_cpu_init();
+        use_avx2 = __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    double score(const packed_pos &pos, const bool color) const override
+    {
+        eval_acc acc;
+        refresh(pos, acc);
+        return score(acc, pos, color);
+    }
+
+    void score(const pos_batch &batch, const bool color, double *out) const override
+    {
+        for (size_t k = 0; k < batch.size(); ++k)
+        {
+            packed_pos pos;
+            pos.w = batch.w[k];
+            pos.b = batch.b[k];
+            pos.wq = batch.wq[k];
+            pos.bq = batch.bq[k];
+            out[k] = score(pos, color);
+        }
+    }
+
+    uint64_t signature() const override
+    {
+        return net_hash;
+    }
+
+    bool incremental() const override
+    {
+        return true;
+    }
+
+    void refresh(const packed_pos &pos, eval_acc &acc) const override
+    {
+        memcpy(acc.v, net.b1, sizeof(acc.v));
+        const uint32_t pieces[4] = {pos.w, pos.b, pos.wq, pos.bq};
+        for (POS_T piece = 1; piece <= 4; ++piece)
+        {
+            for (uint32_t bits = pieces[piece - 1]; bits; bits &= bits - 1)
+            {
+                add_row(acc, nnue_net::feature(piece, __builtin_ctz(bits)), 1);
+            }
+        }
+    }
+
+    void update(const eval_acc &parent, const POS_T piece, const POS_T captured, const move_pos &turn,
+                eval_acc &child) const override
+    {
+        child = parent;
+        // превращение в дамку при достижении края
+        const bool promoted = (piece == 1 && turn.x2 == 0) || (piece == 2 && turn.x2 == geometry8::size - 1);
+        const POS_T new_piece = promoted ? piece + 2 : piece;
+        add_row(child, nnue_net::feature(piece, packed_pos::square(turn.x, turn.y)), -1);
+        add_row(child, nnue_net::feature(new_piece, packed_pos::square(turn.x2, turn.y2)), 1);
+        if (captured)
+            add_row(child, nnue_net::feature(captured, packed_pos::square(turn.xb, turn.yb)), -1);
+    }
+
+    double score(const eval_acc &acc, const packed_pos &pos, const bool color) const override
+    {
+        const bool w_none = !(pos.w | pos.wq), b_none = !(pos.b | pos.bq);
+        if (color ? w_none : b_none)
+            return INF;
+        if (color ? b_none : w_none)
+            return 0;
+        const double z = forward(acc) / double(NNUE_QA * NNUE_QB);
+        // отношение сил в тех же пределах, что и у линейной оценки
+        return exp(max(-20.0, min(20.0, color ? -z : z)));
+    }
+
+private:
+    void add_row(eval_acc &acc, const int feature, const int sign) const
+    {
+#ifdef CHECKERS_X86_SIMD
+        if (use_avx2)
+        {
+            add_row_avx2(acc.v, net.w1[feature], sign);
+            return;
+        }
+#endif
+        for (int i = 0; i < NNUE_L1; ++i)
+            acc.v[i] += sign * net.w1[feature][i];
+    }
+
+    // выход сети в масштабе NNUE_QA * NNUE_QB
+    int32_t forward(const eval_acc &acc) const
+    {
+        int32_t hidden[NNUE_L2];
+#ifdef CHECKERS_X86_SIMD
+        if (use_avx2)
+            layer2_avx2(acc.v, hidden);
+        else
+#endif
+            layer2_scalar(acc.v, hidden);
+        int32_t out = net.b3;
+        for (int o = 0; o < NNUE_L2; ++o)
+        {
+            // ограниченный ReLU второго слоя и возврат к масштабу NNUE_QA
+            out += min(NNUE_QA, max(0, hidden[o]) / NNUE_QB) * net.w3[o];
+        }
+        return out;
+    }
+
+    void layer2_scalar(const int16_t *acc, int32_t *hidden) const
+    {
+        for (int o = 0; o < NNUE_L2; ++o)
+        {
+            int32_t sum = net.b2[o];
+            for (int i = 0; i < NNUE_L1; ++i)
+                sum += min<int32_t>(NNUE_QA, max<int32_t>(0, acc[i])) * net.w2[o][i];
+            hidden[o] = sum;
+        }
+    }
+
+#ifdef CHECKERS_X86_SIMD
+    __attribute__((target("avx2"))) static void add_row_avx2(int16_t *acc, const int16_t *row, const int sign)
+    {
+        for (int i = 0; i < NNUE_L1; i += 16)
+        {
+            const __m256i a = _mm256_load_si256((const __m256i *)(acc + i));
+            const __m256i r = _mm256_load_si256((const __m256i *)(row + i));
+            _mm256_store_si256((__m256i *)(acc + i), sign > 0 ? _mm256_add_epi16(a, r) : _mm256_sub_epi16(a, r));
+        }
+    }
+
+    __attribute__((target("avx2"))) void layer2_avx2(const int16_t *acc, int32_t *hidden) const
+    {
+        // ограниченный ReLU первого слоя: int16 -> uint8 в [0, 127]
+        const __m256i qa = _mm256_set1_epi8(NNUE_QA);
+        __m256i in[2];
+        for (int k = 0; k < 2; ++k)
+        {
+            const __m256i lo = _mm256_load_si256((const __m256i *)(acc + 32 * k));
+            const __m256i hi = _mm256_load_si256((const __m256i *)(acc + 32 * k + 16));
+            // packus перемешивает 64-битные части двух половин регистра, permute восстанавливает порядок
+            const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+            in[k] = _mm256_min_epu8(packed, qa);
+        }
+        const __m256i ones = _mm256_set1_epi16(1);
+        for (int o = 0; o < NNUE_L2; ++o)
+        {
+            const __m256i w0 = _mm256_load_si256((const __m256i *)(net.w2[o]));
+            const __m256i w1 = _mm256_load_si256((const __m256i *)(net.w2[o] + 32));
+            const __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(_mm256_maddubs_epi16(in[0], w0), ones),
+                                                 _mm256_madd_epi16(_mm256_maddubs_epi16(in[1], w1), ones));
+            __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+            s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+            hidden[o] = net.b2[o] + _mm_cvtsi128_si32(s);
+        }
+    }
+#endif
+
+    nnue_net net;
+    uint64_t net_hash;
+    bool use_avx2 = false;
+};
+
+// регистрация типа оценки "NNUE" с весами из nnue.bin. тип выбирается только в сборке с CHECKERS_NNUE:
+// сеть экспериментальная, пока матч с равным временем (Tools/match) не покажет ее выигрыш у "Tuned"
+#ifdef CHECKERS_NNUE
+inline const bool nnue_registered = (Evaluators::add("NNUE",
+                                                     [](const nlohmann::json &) {
+                                                         return make_shared<Nnue_eval>(project_path + "nnue.bin");
+                                                     }),
+                                     true);
+#endif
@@ -0,0 +1,195 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// интервал временной шкалы на одном потоке
+struct trace_event
+{
+    const char *name = nullptr;              // имя (строковая константа)
+    double start_us = 0;                     // начало от запуска трассировки в мкс
+    double duration_us = 0;                  // длительность в мкс
+    const char *arg_name[2] = {nullptr, nullptr}; // числовые аргументы (глубина, узлы), nullptr - нет
+    long long arg[2] = {0, 0};
+};
+
+// трассировка в формате Chrome trace JSON (открывается в Perfetto и chrome://tracing).
+// события пишутся в буферы своих потоков, выключенная трассировка стоит одной проверки флага
+class Trace
+{
+public:
+    typedef chrono::steady_clock clock;
+
+    // включение трассировки, время событий отсчитывается от этого вызова
+    static void start()
+    {
+        if (on)
+            return;
+        epoch = clock::now();
+        on = true;
+    }
+
+    static bool enabled()
+    {
+        return on.load(memory_order_relaxed);
+    }
+
+    // имя потока на временной шкале
+    static void name_thread(const string &name)
+    {
+        if (!enabled())
+            return;
+        thread_buffer &b = local();
+        lock_guard<mutex> lock(b.guard);
+        b.name = name;
+    }
+
+    static void add(const trace_event &event)
+    {
+        thread_buffer &b = local();
+        lock_guard<mutex> lock(b.guard);
+        if (b.events.size() < max_events)
+            b.events.push_back(event);
+        else
+            ++b.dropped;
+    }
+
+    static double since_start_us(const clock::time_point t)
+    {
+        return chrono::duration<double, micro>(t - epoch).count();
+    }
+
+    // запись событий всех потоков в файл path, false если файл не открылся
+    static bool write(const string &path)
+    {
+        ofstream fout(path);
+        if (!fout)
+            return false;
+        // время в мкс с точностью до нс
+        fout << fixed << setprecision(3) << "{\"traceEvents\":[";
+        bool first = true;
+        auto separator = [&]() {
+            fout << (first ? "\n" : ",\n");
+            first = false;
+        };
+        lock_guard<mutex> registry_lock(registry_guard);
+        // потоки с одинаковым именем (вспомогательные потоки корня создаются заново на каждый поиск)
+        // не работают одновременно и показываются одной дорожкой
+        map<string, int> tid_of_name;
+        for (const auto &b : buffers)
+        {
+            lock_guard<mutex> lock(b->guard);
+            const string name = b->name.empty() ? "thread " + to_string(b->tid) : b->name;
+            const auto found = tid_of_name.emplace(name, b->tid);
+            const int tid = found.first->second;
+            if (found.second)
+            {
+                separator();
+                fout << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                     << ",\"args\":{\"name\":\"" << name << "\"}}";
+            }
+            for (const auto &e : b->events)
+            {
+                separator();
+                fout << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                     << ",\"ts\":" << e.start_us << ",\"dur\":" << e.duration_us;
+                if (e.arg_name[0])
+                {
+                    fout << ",\"args\":{\"" << e.arg_name[0] << "\":" << e.arg[0];
+                    if (e.arg_name[1])
+                        fout << ",\"" << e.arg_name[1] << "\":" << e.arg[1];
+                    fout << "}";
+                }
+                fout << "}";
+            }
+            // события сверх лимита буфера не записаны
+            if (b->dropped)
+            {
+                separator();
+                fout << "{\"name\":\"dropped events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << tid
+                     << ",\"ts\":0,\"args\":{\"count\":" << b->dropped << "}}";
+            }
+        }
+        fout << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return bool(fout);
+    }
+
+private:
+    // буфер потока: регистрируется при первом событии и живет до конца программы, даже если поток завершился
+    struct thread_buffer
+    {
+        int tid = 0;
+        string name;
+        vector<trace_event> events;
+        size_t dropped = 0;
+        mutex guard; // запись событий потоком и выгрузка в файл
+    };
+
+    static thread_buffer &local()
+    {
+        thread_local shared_ptr<thread_buffer> buffer;
+        if (!buffer)
+        {
+            buffer = make_shared<thread_buffer>();
+            lock_guard<mutex> lock(registry_guard);
+            buffer->tid = int(buffers.size()) + 1;
+            buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    static constexpr size_t max_events = 1 << 20; // лимит событий одного потока
+    static inline atomic<bool> on{false};
+    static inline clock::time_point epoch;
+    static inline mutex registry_guard;
+    static inline vector<shared_ptr<thread_buffer>> buffers;
+};
+
+// интервал от создания до выхода из области видимости; при выключенной трассировке ничего не делает
+class trace_scope
+{
+public:
+    explicit trace_scope(const char *name) : active(Trace::enabled())
+    {
+        if (!active)
+            return;
+        event.name = name;
+        begin = Trace::clock::now();
+    }
+
+    ~trace_scope()
+    {
+        if (!active)
+            return;
+        const auto end = Trace::clock::now();
+        event.start_us = Trace::since_start_us(begin);
+        event.duration_us = chrono::duration<double, micro>(end - begin).count();
+        Trace::add(event);
+    }
+
+    // числовой аргумент события (не больше двух)
+    void arg(const char *name, const long long value)
+    {
+        if (!active)
+            return;
+        const int k = event.arg_name[0] ? 1 : 0;
+        event.arg_name[k] = name;
+        event.arg[k] = value;
+    }
+
+    trace_scope(const trace_scope &) = delete;
+    trace_scope &operator=(const trace_scope &) = delete;
+
+private:
+    bool active;
+    trace_event event;
+    Trace::clock::time_point begin;
+};
@@ -0,0 +1,283 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../Models/Position.h"
+
+using namespace std;
+
+// случайные ключи Zobrist для фигур на клетках и для хода черных
+struct zobrist
+{
+    uint64_t piece[4][32];
+    uint64_t black_turn;
+
+    zobrist()
+    {
+        uint64_t seed = 0x9E3779B97F4A7C15ull;
+        for (auto &row : piece)
+            for (auto &key : row)
+                key = next(seed);
+        black_turn = next(seed);
+    }
+
+    // ключ позиции с ходящей стороной color
+    static uint64_t key(const packed_pos &pos, const bool color)
+    {
+        static const zobrist keys;
+        uint64_t res = color ? keys.black_turn : 0;
+        const uint32_t pieces[4] = {pos.w, pos.b, pos.wq, pos.bq};
+        for (int p = 0; p < 4; ++p)
+            for (uint32_t bits = pieces[p]; bits; bits &= bits - 1)
+                res ^= keys.piece[p][__builtin_ctz(bits)];
+        return res;
+    }
+
+private:
+    // генератор splitmix64
+    static uint64_t next(uint64_t &state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+// тип оценки в записи: точная или граница, полученная при отсечении
+enum tt_bound : uint8_t
+{
+    TT_EXACT,
+    TT_LOWER, // настоящая оценка не меньше записанной
+    TT_UPPER  // настоящая оценка не больше записанной
+};
+
+// распакованная запись таблицы
+struct tt_entry
+{
+    float score = 0;        // оценка для ходящей стороны (отношение сил, как у calc_score)
+    uint8_t depth = 0;      // оставшаяся глубина поиска
+    tt_bound bound = TT_EXACT;
+    int8_t from = -1;       // клетка начала лучшего хода (-1 - нет хода)
+    int8_t to = -1;         // клетка конца лучшего хода
+};
+
+// общая таблица транспозиций для нескольких потоков поиска без блокировок:
+// запись - два 64-битных слова, ключ хранится в виде key ^ data, поэтому
+// запись, наполовину перезаписанная другим потоком, просто не совпадет по ключу
+class Transposition
+{
+public:
+    Transposition(const size_t size_mb = 16)
+    {
+        resize(size_mb);
+    }
+
+    // размер таблицы в мегабайтах (округляется вниз до степени двойки записей), 0 - таблица выключена
+    void resize(const size_t size_mb)
+    {
+        size_t count = 0;
+        if (size_mb)
+        {
+            count = 1;
+            while (count * 2 * sizeof(slot) <= size_mb * 1024 * 1024)
+                count *= 2;
+        }
+        table = vector<slot>(count);
+        mask = count ? count - 1 : 0;
+    }
+
+    bool enabled() const
+    {
+        return !table.empty();
+    }
+
+    size_t size_mb() const
+    {
+        return table.size() * sizeof(slot) / (1024 * 1024);
+    }
+
+    void clear()
+    {
+        for (auto &s : table)
+        {
+            s.key_xor.store(0, memory_order_relaxed);
+            s.data.store(0, memory_order_relaxed);
+        }
+    }
+
+    // начало нового поиска: записи прошлых поисков вытесняются в первую очередь
+    void new_search()
+    {
+        age.fetch_add(1, memory_order_relaxed);
+    }
+
+    bool probe(const uint64_t key, tt_entry &res) const
+    {
+        if (table.empty())
+            return false;
+        const slot &s = table[key & mask];
+        const uint64_t data = s.data.load(memory_order_relaxed);
+        if ((s.key_xor.load(memory_order_relaxed) ^ data) != key || data == 0)
+            return false;
+        res = unpack(data);
+        return true;
+    }
+
+    // запись заменяет другую позицию из старого поиска или результат не большей глубины
+    void store(const uint64_t key, const tt_entry &entry)
+    {
+        if (table.empty())
+            return;
+        slot &s = table[key & mask];
+        const uint64_t old = s.data.load(memory_order_relaxed);
+        const bool same = (s.key_xor.load(memory_order_relaxed) ^ old) == key;
+        const uint8_t cur_age = uint8_t(age.load(memory_order_relaxed));
+        if (old && uint8_t(old >> 56) == cur_age && !same && unpack(old).depth > entry.depth)
+            return;
+        const uint64_t data = pack(entry, cur_age);
+        s.key_xor.store(key ^ data, memory_order_relaxed);
+        s.data.store(data, memory_order_relaxed);
+    }
+
+    // сохранение записей с оставшейся глубиной не меньше min_depth в файл path: заголовок с подписью
+    // настроек поиска signature и пары (ключ, данные) подряд. false если файл не записан
+    bool save(const string &path, const uint64_t signature, const uint8_t min_depth) const
+    {
+        vector<file_entry> entries;
+        for (const auto &s : table)
+        {
+            const uint64_t data = s.data.load(memory_order_relaxed);
+            if (data && unpack(data).depth >= min_depth)
+                entries.push_back({s.key_xor.load(memory_order_relaxed) ^ data, data});
+        }
+        const file_header header{file_magic, file_version, signature, entries.size()};
+        ofstream fout(path, ios_base::binary | ios_base::trunc);
+        fout.write((const char *)&header, sizeof(header));
+        fout.write((const char *)entries.data(), streamsize(entries.size() * sizeof(file_entry)));
+        return bool(fout);
+    }
+
+    // загрузка записей, сохраненных save, если подпись файла совпадает с signature (иначе записи
+    // посчитаны с другой оценкой или другим поиском и файл пропускается). записи занимают свои места
+    // по ключу, поэтому размер таблицы может отличаться от сохраненного. возвращает число записей
+    size_t load(const string &path, const uint64_t signature)
+    {
+        if (table.empty())
+            return 0;
+        size_t loaded = 0;
+        // файл отображается в память и читается прямо из нее
+        auto read = [&](const char *bytes, const size_t size) {
+            file_header header;
+            if (size < sizeof(header))
+                return;
+            memcpy(&header, bytes, sizeof(header));
+            if (header.magic != file_magic || header.version != file_version || header.signature != signature ||
+                header.count > (size - sizeof(header)) / sizeof(file_entry))
+                return;
+            const uint8_t cur_age = uint8_t(age.load(memory_order_relaxed));
+            for (uint64_t k = 0; k < header.count; ++k)
+            {
+                file_entry e;
+                memcpy(&e, bytes + sizeof(header) + k * sizeof(file_entry), sizeof(e));
+                // записи прошлых сессий вытесняются новыми в первую очередь
+                const uint64_t data = (e.data & ~(uint64_t(255) << 56)) | uint64_t(uint8_t(cur_age - 1)) << 56;
+                slot &s = table[e.key & mask];
+                const uint64_t old = s.data.load(memory_order_relaxed);
+                if (old && unpack(old).depth > unpack(data).depth)
+                    continue;
+                s.key_xor.store(e.key ^ data, memory_order_relaxed);
+                s.data.store(data, memory_order_relaxed);
+                ++loaded;
+            }
+        };
+#if defined(__unix__) || defined(__APPLE__)
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return 0;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *bytes = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (bytes != MAP_FAILED)
+            {
+                read((const char *)bytes, size_t(st.st_size));
+                munmap(bytes, size_t(st.st_size));
+            }
+        }
+        close(fd);
+#else
+        ifstream fin(path, ios_base::binary);
+        const vector<char> bytes((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+        read(bytes.data(), bytes.size());
+#endif
+        return loaded;
+    }
+
+private:
+    // формат файла таблицы: заголовок и записи без выравнивающих промежутков
+    struct file_header
+    {
+        uint32_t magic;
+        uint32_t version;   // версия формата записи (pack)
+        uint64_t signature; // подпись оценки и настроек поиска, с которыми посчитаны записи
+        uint64_t count;     // число записей
+    };
+    struct file_entry
+    {
+        uint64_t key;
+        uint64_t data;
+    };
+    static constexpr uint32_t file_magic = 0x54544B43; // "CKTT"
+    static constexpr uint32_t file_version = 1;
+
+    struct slot
+    {
+        atomic<uint64_t> key_xor{0};
+        atomic<uint64_t> data{0};
+
+        slot() = default;
+        slot(const slot &) : slot()
+        {
+        }
+    };
+
+    // упаковка: 32 бита оценки, 8 бит глубины, 2 бита типа, по 6 бит на клетки хода, 8 бит поколения.
+    // бит 54 всегда установлен, чтобы занятая запись не была нулевой
+    static uint64_t pack(const tt_entry &e, const uint8_t age)
+    {
+        uint32_t score_bits;
+        memcpy(&score_bits, &e.score, sizeof(score_bits));
+        return uint64_t(score_bits) | uint64_t(e.depth) << 32 | uint64_t(e.bound) << 40 |
+               uint64_t(uint8_t(e.from) & 63) << 42 | uint64_t(uint8_t(e.to) & 63) << 48 |
+               uint64_t(1) << 54 | uint64_t(age) << 56;
+    }
+
+    static tt_entry unpack(const uint64_t data)
+    {
+        tt_entry e;
+        const uint32_t score_bits = uint32_t(data);
+        memcpy(&e.score, &score_bits, sizeof(score_bits));
+        e.depth = uint8_t(data >> 32);
+        e.bound = tt_bound((data >> 40) & 3);
+        const int from = (data >> 42) & 63, to = (data >> 48) & 63;
+        e.from = from == 63 ? -1 : int8_t(from);
+        e.to = to == 63 ? -1 : int8_t(to);
+        return e;
+    }
+
+    vector<slot> table;
+    size_t mask = 0;
+    atomic<uint32_t> age{0};
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+#include "Move.h"
+
+// геометрия доски N x N, известная при компиляции: позиция, генерация ходов и оценка параметризованы ею,
+// поэтому у каждого варианта свои полностью специализированные ядра без проверок размера во время работы.
+// черные клетки нумеруются по рядам сверху вниз: клетка (i, j) - номер (бит) i * N / 2 + j / 2
+template <int N> struct board_geometry
+{
+    static constexpr int size = N;                            // клеток в ряду
+    static constexpr int per_row = N / 2;                     // черных клеток в ряду
+    static constexpr int squares = N * N / 2;                 // черных клеток доски: 32 или 50
+    static constexpr int start_rows = (N - 2) / 2;            // рядов с шашками в начальной позиции
+    static constexpr int start_pieces = start_rows * per_row; // шашек одного цвета в начальной позиции
+    static constexpr int max_ray = N - 1;                     // самый длинный диагональный луч
+    // наибольшее число ходов в позиции: все фигуры - дамки с 2N - 3 ходами (на большой диагонали)
+    static constexpr int max_moves = start_pieces * (2 * N - 3);
+    // битовая доска: бит на черную клетку
+    typedef std::conditional_t<(squares <= 32), uint32_t, uint64_t> mask;
+
+    // номер бита для черной клетки (i, j)
+    static constexpr int square(const int i, const int j)
+    {
+        return i * per_row + j / 2;
+    }
+    // черная клетка по номеру бита
+    static constexpr int row(const int s)
+    {
+        return s / per_row;
+    }
+    static constexpr int col(const int s)
+    {
+        return 2 * (s % per_row) + (row(s) + 1) % 2;
+    }
+    static constexpr mask bit(const int s)
+    {
+        return mask(1) << s;
+    }
+};
+
+typedef board_geometry<8> geometry8;   // русские шашки
+// доска 10x10 с правилами русских шашек: это не международные шашки - нет правила взятия большинства,
+// шашка превращается в дамку посреди серии взятий. нужна для замеров ядер на 50 клетках
+typedef board_geometry<10> geometry10;
+
+// клетка доски (строка, столбец)
+struct cell_pos
+{
+    POS_T i = -1, j = -1;
+};
+
+// таблицы лучей доски, посчитанные при компиляции: для каждой черной клетки и каждого направления -
+// клетки диагонального луча до края доски. первая клетка луча - соседняя, вторая - куда встает шашка
+// при взятии, весь луч - ходы и взятия дамки.
+// направления в порядке перебора ходов: 0 - вверх-влево, 1 - вверх-вправо, 2 - вниз-влево, 3 - вниз-вправо
+template <class G> struct board_rays
+{
+    cell_pos ray[G::squares][4][G::max_ray]; // клетки луча от ближней к дальней
+    int8_t ray_len[G::squares][4];           // длина луча (0 у края доски)
+
+    static constexpr board_rays make()
+    {
+        board_rays res{};
+        for (int s = 0; s < G::squares; ++s)
+        {
+            const int i = G::row(s), j = G::col(s);
+            for (int d = 0; d < 4; ++d)
+            {
+                const int di = d < 2 ? -1 : 1, dj = d % 2 ? 1 : -1;
+                int len = 0;
+                for (int i2 = i + di, j2 = j + dj; i2 >= 0 && i2 < G::size && j2 >= 0 && j2 < G::size;
+                     i2 += di, j2 += dj)
+                {
+                    res.ray[s][d][len].i = POS_T(i2);
+                    res.ray[s][d][len].j = POS_T(j2);
+                    ++len;
+                }
+                res.ray_len[s][d] = int8_t(len);
+            }
+        }
+        return res;
+    }
+};
+
+template <class G> inline constexpr board_rays<G> rays_of = board_rays<G>::make();
+
+// маска клеток доски G, для ряда и столбца которых выполнено условие in
+template <class G, class F> constexpr typename G::mask cells_of(const F in)
+{
+    typename G::mask res = 0;
+    for (int s = 0; s < G::squares; ++s)
+        if (in(G::row(s), G::col(s)))
+            res |= G::bit(s);
+    return res;
+}
+
+// битовые маски доски для оценки и сдвиги всех фигур на одну клетку по диагонали ("вверх" - к нулевому ряду).
+// в четных рядах черные клетки в нечетных столбцах, поэтому сдвиг зависит от четности ряда
+template <class G> struct board_masks_of
+{
+    typedef typename G::mask mask;
+    static constexpr int N = G::size;
+    static constexpr int P = G::per_row;
+
+    static constexpr mask ALL = cells_of<G>([](int, int) { return true; });
+    static constexpr mask EVEN_ROWS = cells_of<G>([](int i, int) { return i % 2 == 0; });
+    static constexpr mask ODD_ROWS = cells_of<G>([](int i, int) { return i % 2 == 1; });
+    static constexpr mask LEFT_COL = cells_of<G>([](int, int j) { return j < 2; });       // левые клетки рядов
+    static constexpr mask RIGHT_COL = cells_of<G>([](int, int j) { return j >= N - 2; }); // правые клетки рядов
+    static constexpr mask TOP_ROW = cells_of<G>([](int i, int) { return i == 0; });        // ряд превращения белых
+    static constexpr mask BOTTOM_ROW = cells_of<G>([](int i, int) { return i == N - 1; }); // ряд превращения черных
+    // два ряда перед превращением белых и черных
+    static constexpr mask TOP_RUNAWAY = cells_of<G>([](int i, int) { return i == 1 || i == 2; });
+    static constexpr mask BOTTOM_RUNAWAY = cells_of<G>([](int i, int) { return i == N - 3 || i == N - 2; });
+    static constexpr mask TOP_HALF = cells_of<G>([](int i, int) { return i < N / 2; });
+    static constexpr mask BOTTOM_HALF = cells_of<G>([](int i, int) { return i >= N / 2; });
+    // столбцы и ряды N/2-2 .. N/2+1 (8 клеток на доске 8x8)
+    static constexpr mask CENTER = cells_of<G>(
+        [](int i, int j) { return i >= N / 2 - 2 && i <= N / 2 + 1 && j >= N / 2 - 2 && j <= N / 2 + 1; });
+    // ряды, номер которых содержит бит 0, 1, 2 (и 3 на доске 10x10)
+    static constexpr int ROW_BITS = N > 8 ? 4 : 3;
+    static constexpr mask ROW_BIT[4] = {
+        cells_of<G>([](int i, int) { return (i & 1) != 0; }), cells_of<G>([](int i, int) { return (i & 2) != 0; }),
+        cells_of<G>([](int i, int) { return (i & 4) != 0; }), cells_of<G>([](int i, int) { return (i & 8) != 0; })};
+
+    static mask up_left(const mask x)
+    {
+        return ((x & EVEN_ROWS) >> P) | ((x & ODD_ROWS & ~LEFT_COL) >> (P + 1));
+    }
+    static mask up_right(const mask x)
+    {
+        return ((x & EVEN_ROWS & ~RIGHT_COL) >> (P - 1)) | ((x & ODD_ROWS) >> P);
+    }
+    static mask down_left(const mask x)
+    {
+        return ((x & EVEN_ROWS) << P) | ((x & ODD_ROWS & ~LEFT_COL) << (P - 1));
+    }
+    static mask down_right(const mask x)
+    {
+        return ((x & EVEN_ROWS & ~RIGHT_COL) << (P + 1)) | ((x & ODD_ROWS) << P);
+    }
+};
+
+// список ходов позиции доски G
+template <class G> using move_list_of = basic_move_list<G::max_moves>;
+
+// доска 8x8 - доска игры и поиска
+typedef board_masks_of<geometry8> board_masks;
+typedef move_list_of<geometry8> move_list;
+inline constexpr const board_rays<geometry8> &rays = rays_of<geometry8>;
@@ -11,6 +11,7 @@ struct move_pos
     POS_T x2, y2;           // конечная позиция фигуры
     POS_T xb = -1, yb = -1; // позиция съеденной фигуры (-1 если нет)
 
+    move_pos() = default;
     // конструктор для обычного хода
     move_pos(const POS_T x, const POS_T y, const POS_T x2, const POS_T y2) : x(x), y(y), x2(x2), y2(y2)
     {
@@ -31,3 +32,56 @@ struct move_pos
         return !(*this == other);
     }
 };
+
+// список ходов одной позиции фиксированной емкости: генерация ходов не выделяет память.
+// емкость - наибольшее число ходов в позиции (см. board_geometry::max_moves)
+template <size_t Capacity> struct basic_move_list
+{
+    static constexpr size_t capacity = Capacity;
+
+    move_pos moves[capacity];
+    size_t count = 0;        // число ходов в списке
+    bool have_beats = false; // в списке ходы с боем
+
+    void clear()
+    {
+        count = 0;
+        have_beats = false;
+    }
+    void push(const move_pos &turn)
+    {
+        moves[count++] = turn;
+    }
+    size_t size() const
+    {
+        return count;
+    }
+    bool empty() const
+    {
+        return count == 0;
+    }
+    move_pos &operator[](const size_t i)
+    {
+        return moves[i];
+    }
+    const move_pos &operator[](const size_t i) const
+    {
+        return moves[i];
+    }
+    move_pos *begin()
+    {
+        return moves;
+    }
+    move_pos *end()
+    {
+        return moves + count;
+    }
+    const move_pos *begin() const
+    {
+        return moves;
+    }
+    const move_pos *end() const
+    {
+        return moves + count;
+    }
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Position.h"
+
+using namespace std;
+
+// текстовая запись позиций и ходов для внешних программ.
+// черные клетки нумеруются 1-32 по рядам сверху вниз, как на экране (номер - бит packed_pos плюс один)
+struct notation
+{
+    // номер клетки (i, j)
+    static int square(const POS_T i, const POS_T j)
+    {
+        return packed_pos::square(i, j) + 1;
+    }
+
+    // клетка по номеру, false для номера вне доски
+    static bool cell(const int n, POS_T &i, POS_T &j)
+    {
+        if (n < 1 || n > 32)
+            return false;
+        i = POS_T((n - 1) / 4);
+        j = POS_T(2 * ((n - 1) % 4) + (i + 1) % 2);
+        return true;
+    }
+
+    // номер клетки из записи, false если это не число 1-32 (длинное число не разбирается вовсе)
+    static bool parse_square(const string &text, int &n)
+    {
+        if (text.empty() || text.size() > 2 || text.find_first_not_of("0123456789") != string::npos)
+            return false;
+        n = stoi(text);
+        return n >= 1 && n <= 32;
+    }
+
+    // серия ходов одной стороны: "22-18" для обычного хода, "23x14x5" для серии взятий
+    static string move(const vector<move_pos> &series)
+    {
+        if (series.empty())
+            return "";
+        string res = to_string(square(series[0].x, series[0].y));
+        for (const auto &turn : series)
+        {
+            res += (turn.xb != -1 ? "x" : "-") + to_string(square(turn.x2, turn.y2));
+        }
+        return res;
+    }
+
+    // разбиение хода на номера клеток, false при ошибке записи
+    static bool parse_move(const string &text, vector<int> &squares, bool &is_beat)
+    {
+        squares.clear();
+        is_beat = text.find('x') != string::npos;
+        stringstream in(text);
+        string part;
+        while (getline(in, part, is_beat ? 'x' : '-'))
+        {
+            int n;
+            if (!parse_square(part, n))
+                return false;
+            squares.push_back(n);
+        }
+        return squares.size() >= 2 && (is_beat || squares.size() == 2);
+    }
+
+    // позиция в формате FEN (PDN): "W:W21,22,K5:B1,2" - ходящая сторона, затем белые и черные фигуры, K - дамка
+    static string fen(const packed_pos &pos, const bool color)
+    {
+        string res = color ? "B" : "W";
+        const uint32_t men[2] = {pos.w, pos.b}, kings[2] = {pos.wq, pos.bq};
+        for (int side = 0; side < 2; ++side)
+        {
+            res += side ? ":B" : ":W";
+            bool first = true;
+            for (int n = 0; n < 32; ++n)
+            {
+                const uint32_t bit = uint32_t(1) << n;
+                if (!((men[side] | kings[side]) & bit))
+                    continue;
+                res += (first ? "" : ",") + string((kings[side] & bit) ? "K" : "") + to_string(n + 1);
+                first = false;
+            }
+        }
+        return res;
+    }
+
+    // разбор FEN, false при ошибке записи
+    static bool parse_fen(const string &text, packed_pos &pos, bool &color)
+    {
+        pos = packed_pos();
+        stringstream in(text);
+        string part;
+        if (!getline(in, part, ':') || (part != "W" && part != "B"))
+            return false;
+        color = part == "B";
+        while (getline(in, part, ':'))
+        {
+            if (part.empty() || (part[0] != 'W' && part[0] != 'B'))
+                return false;
+            const bool black = part[0] == 'B';
+            stringstream pieces(part.substr(1));
+            string piece;
+            while (getline(pieces, piece, ','))
+            {
+                const bool king = !piece.empty() && piece[0] == 'K';
+                if (king)
+                    piece.erase(0, 1);
+                int n;
+                if (!parse_square(piece, n))
+                    return false;
+                const uint32_t bit = uint32_t(1) << (n - 1);
+                (king ? (black ? pos.bq : pos.wq) : (black ? pos.b : pos.w)) |= bit;
+            }
+        }
+        // клетка не может быть занята дважды
+        return __builtin_popcount(pos.w) + __builtin_popcount(pos.b) + __builtin_popcount(pos.wq) +
+                   __builtin_popcount(pos.bq) ==
+               __builtin_popcount(pos.w | pos.b | pos.wq | pos.bq);
+    }
+};
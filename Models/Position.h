@@ -0,0 +1,170 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Geometry.h"
+#include "Move.h"
+
+using namespace std;
+
+// упакованная позиция доски G: по одному биту на каждую черную клетку (32 на доске 8x8, 50 на доске 10x10),
+// клетка (i, j) хранится в бите G::square(i, j)
+template <class G> struct basic_packed_pos
+{
+    typedef typename G::mask mask;
+
+    mask w = 0;  // белые шашки
+    mask b = 0;  // черные шашки
+    mask wq = 0; // белые дамки
+    mask bq = 0; // черные дамки
+
+    basic_packed_pos() = default;
+    // начальная расстановка: черные в верхних рядах, белые в нижних, два ряда между ними пустые
+    static basic_packed_pos start()
+    {
+        basic_packed_pos pos;
+        for (int s = 0; s < G::start_pieces; ++s)
+        {
+            pos.b |= G::bit(s);
+            pos.w |= G::bit(G::squares - 1 - s);
+        }
+        return pos;
+    }
+
+    // упаковка матрицы игрового поля
+    explicit basic_packed_pos(const vector<vector<POS_T>> &mtx)
+    {
+        for (POS_T i = 0; i < G::size; ++i)
+        {
+            for (POS_T j = (i + 1) % 2; j < G::size; j += 2)
+            {
+                const mask bit = G::bit(square(i, j));
+                switch (mtx[i][j])
+                {
+                case 1:
+                    w |= bit;
+                    break;
+                case 2:
+                    b |= bit;
+                    break;
+                case 3:
+                    wq |= bit;
+                    break;
+                case 4:
+                    bq |= bit;
+                    break;
+                }
+            }
+        }
+    }
+
+    // распаковка обратно в матрицу игрового поля
+    vector<vector<POS_T>> to_mtx() const
+    {
+        vector<vector<POS_T>> mtx(G::size, vector<POS_T>(G::size, 0));
+        for (POS_T i = 0; i < G::size; ++i)
+        {
+            for (POS_T j = (i + 1) % 2; j < G::size; j += 2)
+            {
+                const mask bit = G::bit(square(i, j));
+                mtx[i][j] = (w & bit) ? 1 : (b & bit) ? 2 : (wq & bit) ? 3 : (bq & bit) ? 4 : 0;
+            }
+        }
+        return mtx;
+    }
+
+    // выполнение хода на копии упакованной позиции
+    basic_packed_pos make_turn(const move_pos &turn) const
+    {
+        basic_packed_pos res = *this;
+        const mask from = G::bit(square(turn.x, turn.y));
+        const mask to = G::bit(square(turn.x2, turn.y2));
+        // удаление съеденной фигуры
+        if (turn.xb != -1)
+        {
+            const mask keep = ~G::bit(square(turn.xb, turn.yb));
+            res.w &= keep;
+            res.b &= keep;
+            res.wq &= keep;
+            res.bq &= keep;
+        }
+        // перемещение фигуры с превращением в дамку при достижении края
+        if (res.w & from)
+        {
+            res.w ^= from;
+            (turn.x2 == 0 ? res.wq : res.w) |= to;
+        }
+        else if (res.b & from)
+        {
+            res.b ^= from;
+            (turn.x2 == G::size - 1 ? res.bq : res.b) |= to;
+        }
+        else if (res.wq & from)
+        {
+            res.wq ^= from | to;
+        }
+        else
+        {
+            res.bq ^= from | to;
+        }
+        return res;
+    }
+
+    bool operator==(const basic_packed_pos &other) const
+    {
+        return w == other.w && b == other.b && wq == other.wq && bq == other.bq;
+    }
+    bool operator!=(const basic_packed_pos &other) const
+    {
+        return !(*this == other);
+    }
+
+    // номер бита для черной клетки (i, j)
+    static int square(const POS_T i, const POS_T j)
+    {
+        return G::square(i, j);
+    }
+};
+
+// позиция игры и поиска (доска 8x8)
+typedef basic_packed_pos<geometry8> packed_pos;
+
+// пакет позиций в виде структуры массивов (SoA) для пакетной оценки
+struct pos_batch
+{
+    vector<uint32_t> w, b, wq, bq;
+
+    void push(const packed_pos &pos)
+    {
+        w.push_back(pos.w);
+        b.push_back(pos.b);
+        wq.push_back(pos.wq);
+        bq.push_back(pos.bq);
+    }
+
+    void push(const vector<vector<POS_T>> &mtx)
+    {
+        push(packed_pos(mtx));
+    }
+
+    void reserve(const size_t n)
+    {
+        w.reserve(n);
+        b.reserve(n);
+        wq.reserve(n);
+        bq.reserve(n);
+    }
+
+    void clear()
+    {
+        w.clear();
+        b.clear();
+        wq.clear();
+        bq.clear();
+    }
+
+    size_t size() const
+    {
+        return w.size();
+    }
+};
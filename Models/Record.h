@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include "Position.h"
+
+using namespace std;
+
+// запись сыгранной партии: все позиции и результат
+// (результат как в Game::play: 0 - ничья, 1 - победа белых, 2 - победа черных)
+struct game_record
+{
+    uint8_t result = 0;
+    vector<packed_pos> positions;
+
+    // двоичный формат: 4 байта числа позиций, 1 байт результата, затем по 16 байт на позицию
+    void write(ostream &out) const
+    {
+        const uint32_t n = uint32_t(positions.size());
+        out.write((const char *)&n, sizeof(n));
+        out.write((const char *)&result, sizeof(result));
+        for (const auto &pos : positions)
+        {
+            const uint32_t bits[4] = {pos.w, pos.b, pos.wq, pos.bq};
+            out.write((const char *)bits, sizeof(bits));
+        }
+    }
+
+    // позиций в партии не больше: в поврежденном файле число позиций может быть любым
+    static constexpr uint32_t max_positions = 1 << 16;
+
+    // чтение следующей партии, false если файл закончился или поврежден
+    bool read(istream &in)
+    {
+        uint32_t n = 0;
+        if (!in.read((char *)&n, sizeof(n)) || !in.read((char *)&result, sizeof(result)) || n > max_positions)
+            return false;
+        positions.resize(n);
+        for (auto &pos : positions)
+        {
+            uint32_t bits[4];
+            if (!in.read((char *)bits, sizeof(bits)))
+                return false;
+            pos.w = bits[0];
+            pos.b = bits[1];
+            pos.wq = bits[2];
+            pos.bq = bits[3];
+        }
+        return true;
+    }
+};
@@ -0,0 +1,89 @@
+// оценка каждого хода записанных партий: лучший ход, оценка позиции и потеря сделанного хода с пометкой
+// неточностей и ошибок (Game/Annotate.h). партии читаются из games.bin игры или матча (Tools/match.cpp),
+// результат - по строке JSON на партию в stdout.
+// настройки поиска и оценки берутся из settings.json; поиск корня в одном потоке, потоки делят позиции.
+// запуск: annotate [games.bin] [потоков] [depth N] [movetime MS] [nodes N] (по умолчанию depth 8).
+// annotate check [потоков] [ограничения] - проверка порогов пометок на партии с известной ошибкой
+#include <iostream>
+
+#include "../Game/Annotate.h"
+#include "../Models/Record.h"
+
+// партия с известной ошибкой: черные ходом 12-16 отдают шашку без размена (19x12), ход должен получить
+// пометку "?" или "??"
+static const char *const check_moves = "22-18 11-15 18x11 8x15 21-17 4-8 23-19 12-16 19x12";
+static const size_t check_ply = 7;
+
+// позиции партии из начальной позиции, как в записи матча: по одной после каждого хода
+static vector<packed_pos> game_positions(Config *config, const string &moves)
+{
+    Analysis analysis(config);
+    vector<packed_pos> res = {packed_pos(analysis.mtx)};
+    istringstream in(moves);
+    string move;
+    while (in >> move)
+    {
+        if (!analysis.apply_move(move))
+            throw runtime_error("illegal move " + move);
+        res.emplace_back(analysis.mtx);
+    }
+    return res;
+}
+
+int main(int argc, char *argv[])
+{
+    const string path = argc > 1 ? argv[1] : "games.bin";
+    const size_t threads = argc > 2 ? size_t(max(1, atoi(argv[2]))) : max(1u, thread::hardware_concurrency());
+    string limits_text;
+    for (int k = 3; k < argc; ++k)
+        limits_text += string(argv[k]) + " ";
+    istringstream limits_in(limits_text.empty() ? "depth 8" : limits_text);
+    const search_limits limits = search_limits::parse(limits_in);
+    try
+    {
+        settings s = *Config().snapshot();
+        s.no_random = true;
+        s.watch_settings = false;
+        Config config(s);
+        Transposition tt(s.tt_size_mb);
+        const Annotator annotator(&config, &tt, threads);
+
+        if (path == "check")
+        {
+            const auto moves = annotator.annotate(game_positions(&config, check_moves), limits);
+            const annotated_move &m = moves.at(check_ply);
+            cout << m.to_json().dump() << endl;
+            if (m.mark != "?" && m.mark != "??")
+            {
+                cerr << "the move " << m.played << " dropping a man is not marked as a mistake" << endl;
+                return 1;
+            }
+            return 0;
+        }
+
+        ifstream fin(path, ios_base::binary);
+        if (!fin)
+            throw runtime_error("can't open " + path);
+        game_record record;
+        for (size_t game = 0; record.read(fin); ++game)
+        {
+            json res = {{"game", game}, {"result", record.result}, {"moves", json::array()}};
+            try
+            {
+                for (const auto &m : annotator.annotate(record.positions, limits))
+                    res["moves"].push_back(m.to_json());
+            }
+            catch (const exception &e)
+            {
+                res["error"] = e.what();
+            }
+            cout << res.dump() << endl;
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
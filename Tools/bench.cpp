@@ -0,0 +1,177 @@
+// замер скорости поиска на постоянном наборе позиций: дебют, середина игры, комбинации с сериями взятий
+// и окончания, каждая ищется итеративным углублением до своей глубины, как командой go движка.
+// случайность отключена, таблица транспозиций очищается перед каждой позицией, поэтому число узлов
+// зависит только от кода и настроек поиска и служит подписью для сравнения коммитов.
+// остальные настройки (Optimization, QuiescenceNodes, TTSizeMB, оценки ботов - оценку ходящей стороны
+// выбирает ее бот) берутся из settings.json.
+// результат - JSON в stdout: узлы, время и скорость по позициям и всего.
+// запуск: bench [добавка к глубине, например -2 для быстрой проверки]
+// bench perft [глубина] - проверка генератора ходов: число партий заданной длины из начальной позиции на досках
+// 8x8 и 10x10 сверяется с известными значениями, маски доски 8x8 - с лучами и прежними константами
+#include <iostream>
+
+#include "../Game/Analysis.h"
+
+// позиция набора в записи команды position
+struct bench_position
+{
+    const char *name;
+    const char *position;
+    size_t depth;
+};
+
+static const bench_position positions[] = {
+    {"opening", "startpos", 10},
+    {"opening-exchange", "startpos moves 22-18 11-15 18x11 8x15 21-17 4-8 23-19", 10},
+    {"middlegame", "fen W:W18,19,21,22,23,25,26,27,29,30,31:B2,3,5,6,7,9,10,11,13,16,20", 12},
+    {"middlegame-kings", "fen B:W14,15,21,23,24,27,K30:B1,2,4,6,9,12,K32", 10},
+    {"tactic-triple-capture", "fen W:W22,25,26,30,31:B9,10,14,17,18,19,24", 14},
+    {"tactic-king-shot", "fen W:WK29,26,30,31:BK4,12,16,3", 10},
+    {"endgame-kings", "fen B:WK18,K27,30,31:BK3,7,10", 10},
+    {"endgame-men", "fen W:W21,22,27,28:B5,6,12,13", 14},
+};
+
+// маски доски 8x8 совпадают с константами, которые были до шаблона геометрии
+static_assert(board_masks::ALL == 0xFFFFFFFFu && board_masks::CENTER == 0x00666600u, "8x8 masks");
+static_assert(board_masks::EVEN_ROWS == 0x0F0F0F0Fu && board_masks::ODD_ROWS == 0xF0F0F0F0u, "8x8 masks");
+static_assert(board_masks::LEFT_COL == 0x11111111u && board_masks::RIGHT_COL == 0x88888888u, "8x8 masks");
+static_assert(board_masks::TOP_ROW == 0xFu && board_masks::BOTTOM_ROW == 0xF0000000u, "8x8 masks");
+static_assert(board_masks::TOP_RUNAWAY == 0xFF0u && board_masks::BOTTOM_RUNAWAY == 0x0FF00000u, "8x8 masks");
+static_assert(board_masks::TOP_HALF == 0xFFFFu && board_masks::BOTTOM_HALF == 0xFFFF0000u, "8x8 masks");
+
+// число партий из depth полных ходов (серия взятий - один ход) стороны color из позиции mtx.
+// x, y - шашка, продолжающая серию взятий
+template <class G>
+static uint64_t perft(const vector<vector<POS_T>> &mtx, const bool color, const int depth, const POS_T x = -1,
+                      const POS_T y = -1)
+{
+    typedef movegen<G> rules;
+    typename rules::list_t list;
+    if (x != -1)
+    {
+        rules::piece_turns(x, y, mtx, list);
+        if (!list.have_beats)
+            return perft<G>(mtx, !color, depth - 1);
+    }
+    else if (depth == 0)
+        return 1;
+    else
+        rules::side_turns(color, mtx, list);
+    uint64_t res = 0;
+    for (const auto &turn : list)
+    {
+        const auto next = rules::make_turn(mtx, turn);
+        res += turn.xb != -1 ? perft<G>(next, color, depth, turn.x2, turn.y2) : perft<G>(next, !color, depth - 1);
+    }
+    return res;
+}
+
+// сдвиги масок доски G на соседнюю клетку совпадают с первыми клетками лучей
+template <class G> static bool shifts_match_rays()
+{
+    typedef board_masks_of<G> M;
+    const auto &r = rays_of<G>;
+    for (int s = 0; s < G::squares; ++s)
+    {
+        const typename G::mask m = G::bit(s);
+        const typename G::mask shifted[4] = {M::up_left(m), M::up_right(m), M::down_left(m), M::down_right(m)};
+        for (int d = 0; d < 4; ++d)
+        {
+            const typename G::mask next = r.ray_len[s][d] ? G::bit(G::square(r.ray[s][d][0].i, r.ray[s][d][0].j)) : 0;
+            if ((shifted[d] & M::ALL) != next)
+                return false;
+        }
+    }
+    return true;
+}
+
+// perft начальных позиций: 8x8 - известные значения русских шашек, 10x10 - записанные значения этих же правил
+// на большой доске (международные шашки расходятся с ними с глубины 5 из-за правила взятия большинства).
+// глубины за концом таблиц только печатаются
+static int run_perft(const int max_depth)
+{
+    static const uint64_t expected8[] = {1, 7, 49, 302, 1469, 7482, 37986, 190146};
+    static const uint64_t expected10[] = {1, 9, 81, 658, 4265, 27132, 168316, 1060829};
+    bool ok = shifts_match_rays<geometry8>() && shifts_match_rays<geometry10>();
+    json res;
+    res["masks"] = ok;
+    const auto start8 = packed_pos::start().to_mtx();
+    const auto start10 = basic_packed_pos<geometry10>::start().to_mtx();
+    for (int depth = 1; depth <= max_depth; ++depth)
+    {
+        const uint64_t n8 = perft<geometry8>(start8, false, depth);
+        const uint64_t n10 = perft<geometry10>(start10, false, depth);
+        const bool ok8 = depth >= int(size(expected8)) || n8 == expected8[depth];
+        const bool ok10 = depth >= int(size(expected10)) || n10 == expected10[depth];
+        ok = ok && ok8 && ok10;
+        res["perft"].push_back({{"depth", depth}, {"8x8", n8}, {"10x10", n10}, {"ok", ok8 && ok10}});
+    }
+    res["ok"] = ok;
+    cout << res.dump(2) << endl;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && string(argv[1]) == "perft")
+        return run_perft(argc > 2 ? atoi(argv[2]) : 5);
+    const int extra_depth = argc > 1 ? atoi(argv[1]) : 0;
+    try
+    {
+        settings s = *Config().snapshot();
+        s.no_random = true;
+        // параллельный корень без детерминированного режима делит окно между потоками по времени их работы:
+        // число узлов бенчмарка должно повторяться от запуска к запуску
+        if (s.threads > 1)
+            s.deterministic = true;
+        s.watch_settings = false;
+        Config config(s);
+        Transposition tt(s.tt_size_mb);
+
+        json res;
+        res["settings"] = {{"Optimization", "O" + to_string(int(s.optimization))},
+                           {"QuiescenceNodes", s.quiescence_nodes},
+                           {"TTSizeMB", tt.size_mb()},
+                           {"Threads", s.threads},
+                           {"Deterministic", s.deterministic},
+                           {"WhiteEval", s.eval_type(false)},
+                           {"BlackEval", s.eval_type(true)}};
+        size_t total_nodes = 0;
+        double total_ms = 0;
+        const atomic<bool> stop{false};
+        for (const auto &p : positions)
+        {
+            Analysis analysis(&config, &tt);
+            istringstream position(p.position);
+            const string error = analysis.set_position(position);
+            if (!error.empty())
+                throw runtime_error(string(p.name) + ": " + error);
+            tt.clear();
+            search_limits limits;
+            limits.depth = size_t(max(1, int(p.depth) + extra_depth));
+            search_info last;
+            const auto start = chrono::steady_clock::now();
+            const auto best = analysis.search(limits, stop, [&last](const search_info &info) { last = info; });
+            const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            total_nodes += last.nodes;
+            total_ms += ms;
+            res["positions"].push_back({{"name", p.name},
+                                        {"position", p.position},
+                                        {"depth", last.depth},
+                                        {"nodes", last.nodes},
+                                        {"time_ms", ms},
+                                        {"nps", ms > 0 ? uint64_t(last.nodes * 1000 / ms) : 0},
+                                        {"bestmove", best.empty() ? string("none") : notation::move(best)}});
+        }
+        res["total"] = {{"nodes", total_nodes},
+                        {"time_ms", total_ms},
+                        {"nps", total_ms > 0 ? uint64_t(total_nodes * 1000 / total_ms) : 0}};
+        cout << res.dump(2) << endl;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
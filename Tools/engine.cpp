@@ -0,0 +1,189 @@
+// движок без графики для анализа из скриптов: команды по строке через stdin, ответы в stdout.
+//   position startpos [moves m1 m2 ...] | position fen <fen> [moves m1 m2 ...]
+//   go [depth N] [movetime MS] [nodes N] - итеративное углубление, после каждой глубины строка info
+//   stop, isready, quit
+// ходы записываются номерами клеток 1-32 (Models/Notation.h): "22-18" или серия взятий "23x14x5".
+// настройки поиска и оценки берутся из settings.json, как у бота в игре; изменения файла применяются со следующего go
+// engine check - проверка разбора команды position на неправильных записях
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "../Game/Analysis.h"
+
+class Engine
+{
+public:
+    Engine() : tt_size_mb(config.snapshot()->tt_size_mb), tt(tt_size_mb), analysis(&config, &tt)
+    {
+        // таблица прошлых запусков: глубоко посчитанные позиции находятся без поиска
+        tt_file = config.snapshot()->tt_file;
+        if (!tt_file.empty())
+            say("info string tt file entries loaded " +
+                to_string(tt.load(project_path + tt_file, analysis.logic.tt_signature())));
+        // файл трассировки берется из настроек при запуске и записывается при выходе
+        trace_file = config.snapshot()->trace_file;
+        if (!trace_file.empty())
+        {
+            Trace::start();
+            Trace::name_thread("engine");
+        }
+        config.watch([this](const string &error) {
+            say(error.empty() ? "info string settings reloaded" : "info string " + error);
+        });
+    }
+
+    ~Engine()
+    {
+        stop_search();
+        const uint8_t tt_file_depth = uint8_t(min(config.snapshot()->tt_file_depth, 255u));
+        if (!tt_file.empty() && !tt.save(project_path + tt_file, analysis.logic.tt_signature(), tt_file_depth))
+            cerr << "can't write tt file " << project_path + tt_file << endl;
+        if (!trace_file.empty() && !Trace::write(project_path + trace_file))
+            cerr << "can't write trace file " << project_path + trace_file << endl;
+    }
+
+    // обработка команд до quit или конца ввода
+    void run()
+    {
+        string line;
+        while (getline(cin, line))
+        {
+            istringstream in(line);
+            string cmd;
+            in >> cmd;
+            if (cmd == "uci")
+            {
+                say("id name Checkers");
+                say("uciok");
+            }
+            else if (cmd == "isready")
+                say("readyok");
+            else if (cmd == "position")
+            {
+                wait_search();
+                const string error = analysis.set_position(in);
+                if (!error.empty())
+                    say("info string " + error);
+            }
+            else if (cmd == "go")
+            {
+                wait_search();
+                // размер таблицы меняется, только пока поиск не идет
+                const size_t size_mb = config.snapshot()->tt_size_mb;
+                if (size_mb != tt_size_mb)
+                    tt.resize(tt_size_mb = size_mb);
+                go(search_limits::parse(in));
+            }
+            else if (cmd == "stop")
+                stop_search();
+            else if (cmd == "quit")
+                break;
+            else if (!cmd.empty())
+                say("info string unknown command " + cmd);
+        }
+        // конец ввода: поиск с ограничениями доводится до конца
+        if (cin.eof())
+            wait_search();
+    }
+
+private:
+    // вывод строки ответа (строки info пишет поток поиска)
+    void say(const string &line)
+    {
+        lock_guard<mutex> lock(out_mutex);
+        cout << line << endl;
+    }
+
+    void go(const search_limits limits)
+    {
+        stop = false;
+        infinite = limits.infinite();
+        worker = thread([this, limits]() {
+            Trace::name_thread("search");
+            const auto best = analysis.search(limits, stop, [this](const search_info &info) { say(info.text()); });
+            say("bestmove " + (best.empty() ? string("none") : notation::move(best)));
+        });
+    }
+
+    // остановка поиска: флаг проверяется и внутри итерации, ответом будет лучший ход, найденный к этому моменту
+    void stop_search()
+    {
+        stop = true;
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // новая команда дожидается поиска с ограничениями, чтобы скрипты могли не ждать bestmove;
+    // поиск без ограничений останавливается
+    void wait_search()
+    {
+        if (infinite)
+            stop = true;
+        if (worker.joinable())
+            worker.join();
+    }
+
+    mutex out_mutex; // вывод из основного потока, потока поиска и потока наблюдения за настройками
+    Config config;
+    size_t tt_size_mb;        // размер таблицы из настроек
+    Transposition tt;         // таблица транспозиций, сохраняется между командами go
+    Analysis analysis;        // позиция и поиск
+    thread worker;            // поток поиска
+    atomic<bool> stop{false}; // запрос остановки поиска
+    bool infinite = false;    // текущий поиск без ограничений (до stop)
+    string trace_file;        // файл трассировки ("" - выключена)
+    string tt_file;           // файл таблицы между запусками ("" - не сохраняется)
+};
+
+// записи команды position и ожидаемый ответ: неправильная запись дает текст ошибки, а не исключение
+static const pair<const char *, const char *> position_checks[] = {
+    {"startpos moves 22-18 11-15 18x11 8x15", ""},
+    {"fen W:W21,22,K5:B1,2 moves 22-18", ""},
+    {"fen W:W99999999999:B1", "bad fen W:W99999999999:B1"},
+    {"fen W:W33:B1", "bad fen W:W33:B1"},
+    {"fen W:WK:B1", "bad fen W:WK:B1"},
+    {"startpos moves 22-999999999999", "illegal move 22-999999999999"},
+    {"startpos moves 22x99999999999x5", "illegal move 22x99999999999x5"},
+    {"startpos moves 22-0", "illegal move 22-0"},
+};
+
+static int check_positions()
+{
+    Config config;
+    Analysis analysis(&config);
+    bool ok = true;
+    for (const auto &check : position_checks)
+    {
+        istringstream in(check.first);
+        const string error = analysis.set_position(in);
+        if (error != check.second)
+        {
+            cerr << "position " << check.first << ": \"" << error << "\", expected \"" << check.second << "\""
+                 << endl;
+            ok = false;
+        }
+    }
+    cout << (ok ? "ok" : "failed") << endl;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+    ios_base::sync_with_stdio(false);
+    // ответы сбрасываются построчно, а чтение cin не должно сбрасывать cout одновременно с потоком поиска
+    cin.tie(nullptr);
+    try
+    {
+        if (argc > 1 && string(argv[1]) == "check")
+            return check_positions();
+        Engine engine;
+        engine.run();
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
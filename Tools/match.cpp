@@ -0,0 +1,416 @@
+// матч двух настроек бота без графики, распределенный по процессам и машинам через общий каталог
+// (общая файловая система кластера, других служб не нужно). координатор записывает задания партий
+// в очередь на диске, рабочие забирают их атомарным переименованием файла и возвращают двоичные
+// записи партий, координатор сводит счет.
+//   match coordinator <каталог> <настройки A> <настройки B> <партий> [файл дебютов]
+//   match worker <каталог>
+//   match local <каталог> <настройки A> <настройки B> <партий> <рабочих> [файл дебютов]
+// каталог очереди:
+//   a.json, b.json - копии настроек сторон; match.json - число партий, пишется последним (очередь готова)
+//   jobs/N.json - задания в ожидании, claimed/N.json.<рабочий> - взятые, results/N.rec - сыгранные партии
+//   games.bin - все партии по порядку номеров, done - матч окончен, рабочие завершаются
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "../Game/Analysis.h"
+#include "../Models/Record.h"
+
+namespace fs = std::filesystem;
+
+static const auto poll_interval = chrono::milliseconds(200); // опрос каталога очереди
+static const auto stale_claim = chrono::minutes(10);         // взятое задание без признаков жизни рабочего
+static const int random_plies = 4; // случайных полуходов дебюта, если файл дебютов не задан
+
+// задание: одна партия
+struct match_job
+{
+    size_t id = 0;
+    bool a_white = true;         // сторона A играет белыми
+    unsigned seed = 0;           // зерно случайности ботов
+    string opening = "startpos"; // начальная позиция в записи команды position движка
+
+    json to_json() const
+    {
+        return {{"id", id}, {"a_white", a_white}, {"seed", seed}, {"opening", opening}};
+    }
+
+    static match_job from_json(const json &j)
+    {
+        match_job job;
+        job.id = j.at("id").get<size_t>();
+        job.a_white = j.at("a_white").get<bool>();
+        job.seed = j.at("seed").get<unsigned>();
+        job.opening = j.at("opening").get<string>();
+        return job;
+    }
+};
+
+// имя файла задания и результата: номер с ведущими нулями, чтобы файлы шли по порядку
+static string job_name(const size_t id)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%06zu", id);
+    return buf;
+}
+
+static settings read_settings(const fs::path &path)
+{
+    ifstream fin(path);
+    if (!fin)
+        throw runtime_error("can't open " + path.string());
+    // в файлах настроек допускаются комментарии после значений, как в settings.json
+    settings s = settings::parse(json::parse(fin, nullptr, true, true));
+    s.watch_settings = false;
+    return s;
+}
+
+// файл пишется под временным именем и переименовывается: другие процессы видят его только целиком
+static void publish(const fs::path &path, const string &bytes, const string &writer)
+{
+    const fs::path tmp = path.string() + ".tmp." + writer;
+    ofstream fout(tmp, ios_base::binary | ios_base::trunc);
+    fout.write(bytes.data(), streamsize(bytes.size()));
+    fout.close();
+    if (!fout)
+        throw runtime_error("can't write " + tmp.string());
+    fs::rename(tmp, path);
+}
+
+// имя процесса в очереди: машина и номер процесса
+static string process_name()
+{
+    char host[256] = {};
+    gethostname(host, sizeof(host) - 1);
+    return string(host) + "-" + to_string(getpid());
+}
+
+// партия задания job: у каждой стороны свои настройки, таблица и поиск, сторона ходит по настройкам бота
+// своего цвета (уровень - глубина поиска, как в игре). alive вызывается после каждого хода
+static game_record play_game(const match_job &job, const settings &a, const settings &b,
+                             const function<void()> &alive)
+{
+    const settings &white = job.a_white ? a : b, &black = job.a_white ? b : a;
+    Config config[2] = {Config(white), Config(black)};
+    Transposition tt[2] = {Transposition(white.tt_size_mb), Transposition(black.tt_size_mb)};
+    Logic logic[2] = {Logic(&config[0], &tt[0]), Logic(&config[1], &tt[1])};
+    logic[0].seed(job.seed);
+    logic[1].seed(job.seed + 1);
+
+    Analysis opening(&config[0]);
+    istringstream in(job.opening);
+    const string error = opening.set_position(in);
+    if (!error.empty())
+        throw runtime_error("job " + to_string(job.id) + ": " + error);
+    vector<vector<POS_T>> mtx = opening.mtx;
+    bool color = opening.color;
+
+    game_record record;
+    record.positions.emplace_back(mtx);
+    position_history history = opening.logic.history;
+    // результат как в Game::play: 0 - ничья по числу ходов, повторению или ходам без продвижения (правила A),
+    // 1 - победа белых, 2 - победа черных
+    for (unsigned turn = 0; turn < a.max_turns; ++turn)
+    {
+        if (turn)
+            history.push(packed_pos(mtx), color);
+        if (history.is_draw(a.repetition_draw, 2 * size_t(a.no_progress_moves)))
+            break;
+        Logic &side = logic[color];
+        side.history = history;
+        side.find_turns(color, mtx);
+        if (side.turns.empty())
+        {
+            record.result = color ? 1 : 2;
+            return record;
+        }
+        side.Max_depth = side.snapshot()->bot[color].level;
+        for (const auto &t : side.find_best_turns(color, mtx))
+            mtx = packed_pos(mtx).make_turn(t).to_mtx();
+        color = !color;
+        record.positions.emplace_back(mtx);
+        alive();
+    }
+    record.result = 0;
+    return record;
+}
+
+// случайный дебют: random_plies ходов с полными сериями взятий от начальной позиции
+static string random_opening(Logic &logic, mt19937 &rng)
+{
+    vector<vector<POS_T>> mtx = packed_pos::start().to_mtx();
+    string res = "startpos moves";
+    bool color = false;
+    for (int ply = 0; ply < random_plies; ++ply)
+    {
+        logic.find_turns(color, mtx);
+        if (logic.turns.empty())
+            break;
+        vector<move_pos> series{logic.turns[rng() % logic.turns.size()]};
+        mtx = packed_pos(mtx).make_turn(series.back()).to_mtx();
+        while (series.back().xb != -1)
+        {
+            logic.find_turns(series.back().x2, series.back().y2, mtx);
+            if (!logic.have_beats)
+                break;
+            series.push_back(logic.turns[rng() % logic.turns.size()]);
+            mtx = packed_pos(mtx).make_turn(series.back()).to_mtx();
+        }
+        res += " " + notation::move(series);
+        color = !color;
+    }
+    return res;
+}
+
+// создание очереди: настройки сторон, задания и match.json. каждый дебют играется дважды со сменой цветов.
+// если очередь уже создана, матч продолжается с нее. возвращает число партий
+static size_t create_queue(const fs::path &dir, const string &a_path, const string &b_path, const size_t games,
+                           const string &openings_path)
+{
+    if (fs::exists(dir / "match.json"))
+    {
+        ifstream fin(dir / "match.json");
+        const size_t stored = json::parse(fin).at("games").get<size_t>();
+        cerr << "resuming the match in " << dir.string() << ": " << stored << " games" << endl;
+        return stored;
+    }
+    for (const char *sub : {"jobs", "claimed", "results"})
+        fs::create_directories(dir / sub);
+    const settings a = read_settings(a_path);
+    read_settings(b_path);
+    fs::copy_file(a_path, dir / "a.json", fs::copy_options::overwrite_existing);
+    fs::copy_file(b_path, dir / "b.json", fs::copy_options::overwrite_existing);
+
+    vector<string> openings;
+    if (!openings_path.empty())
+    {
+        ifstream fin(openings_path);
+        if (!fin)
+            throw runtime_error("can't open " + openings_path);
+        for (string line; getline(fin, line);)
+            if (line.find_first_not_of(" \t\r") != string::npos)
+                openings.push_back(line);
+        if (openings.empty())
+            throw runtime_error(openings_path + " has no positions");
+    }
+    else
+    {
+        Config config(a);
+        Logic logic(&config);
+        // порядок ходов генератора тоже случаен: дебюты зависят только от зерна
+        logic.seed(1);
+        mt19937 rng(1);
+        for (size_t k = 0; k < (games + 1) / 2; ++k)
+            openings.push_back(random_opening(logic, rng));
+    }
+    // дебюты проверяются до раздачи: ошибка в файле не должна всплывать у рабочих
+    {
+        Config config(a);
+        Analysis analysis(&config);
+        for (const auto &opening : openings)
+        {
+            istringstream in(opening);
+            const string error = analysis.set_position(in);
+            if (!error.empty())
+                throw runtime_error("opening \"" + opening + "\": " + error);
+        }
+    }
+    const string me = process_name();
+    for (size_t id = 0; id < games; ++id)
+    {
+        match_job job;
+        job.id = id;
+        job.a_white = id % 2 == 0;
+        job.seed = unsigned(id / 2 + 1);
+        job.opening = openings[(id / 2) % openings.size()];
+        publish(dir / "jobs" / (job_name(id) + ".json"), job.to_json().dump(), me);
+    }
+    publish(dir / "match.json", json{{"games", games}}.dump(), me);
+    return games;
+}
+
+// рабочий: забирает задания, пока координатор не отметит конец матча
+static int run_worker(const fs::path &dir)
+{
+    const string me = process_name();
+    while (!fs::exists(dir / "match.json"))
+        this_thread::sleep_for(poll_interval);
+    const settings a = read_settings(dir / "a.json"), b = read_settings(dir / "b.json");
+    size_t played = 0;
+    while (!fs::exists(dir / "done"))
+    {
+        vector<fs::path> pending;
+        error_code ec;
+        for (const auto &entry : fs::directory_iterator(dir / "jobs", ec))
+            if (entry.path().extension() == ".json")
+                pending.push_back(entry.path());
+        sort(pending.begin(), pending.end());
+        bool claimed_job = false;
+        for (const auto &job_path : pending)
+        {
+            // переименование атомарно: задание достается одному рабочему, остальные получают ошибку
+            const fs::path claimed = dir / "claimed" / (job_path.filename().string() + "." + me);
+            fs::rename(job_path, claimed, ec);
+            if (ec)
+                continue;
+            ifstream fin(claimed);
+            const match_job job = match_job::from_json(json::parse(fin));
+            fin.close();
+            // время изменения взятого задания - признак жизни рабочего для координатора
+            const game_record record = play_game(job, a, b, [&]() {
+                fs::last_write_time(claimed, fs::file_time_type::clock::now(), ec);
+            });
+            ostringstream out;
+            record.write(out);
+            publish(dir / "results" / (job_name(job.id) + ".rec"), out.str(), me);
+            fs::remove(claimed, ec);
+            ++played;
+            claimed_job = true;
+            break;
+        }
+        if (!claimed_job)
+            this_thread::sleep_for(poll_interval);
+    }
+    cerr << "worker " << me << ": " << played << " games" << endl;
+    return 0;
+}
+
+// сбор результатов до последней партии: счет стороны A, возврат заданий умерших рабочих в очередь,
+// games.bin и done в конце. итог - JSON в stdout
+static int collect(const fs::path &dir, const size_t games)
+{
+    vector<int> results(games, -1);
+    size_t merged = 0;
+    size_t score[3] = {0, 0, 0}; // победы, ничьи и поражения стороны A
+    while (merged < games)
+    {
+        error_code ec;
+        vector<fs::path> finished;
+        for (const auto &entry : fs::directory_iterator(dir / "results", ec))
+            if (entry.path().extension() == ".rec")
+                finished.push_back(entry.path());
+        sort(finished.begin(), finished.end());
+        for (const auto &path : finished)
+        {
+            const size_t id = stoul(path.stem().string());
+            if (id >= games || results[id] != -1)
+                continue;
+            ifstream fin(path, ios_base::binary);
+            game_record record;
+            if (!record.read(fin))
+                throw runtime_error("bad result " + path.string());
+            results[id] = record.result;
+            const bool a_white = id % 2 == 0;
+            ++score[record.result == 0 ? 1 : (record.result == 1) == a_white ? 0 : 2];
+            ++merged;
+            cerr << "game " << id << ": " << (record.result == 0 ? "draw" : record.result == 1 ? "white" : "black")
+                 << ", A +" << score[0] << " =" << score[1] << " -" << score[2] << " (" << merged << "/" << games
+                 << ")" << endl;
+        }
+        // задание, которое рабочий давно не отмечал, возвращается в очередь; поздний результат
+        // того же задания просто заменит файл результата
+        const auto now = fs::file_time_type::clock::now();
+        for (const auto &entry : fs::directory_iterator(dir / "claimed", ec))
+        {
+            const string name = entry.path().filename().string();
+            const size_t dot = name.find(".json.");
+            if (dot == string::npos || now - fs::last_write_time(entry.path(), ec) < stale_claim)
+                continue;
+            fs::rename(entry.path(), dir / "jobs" / name.substr(0, dot + 5), ec);
+            if (!ec)
+                cerr << "requeued " << name << endl;
+        }
+        if (merged < games)
+            this_thread::sleep_for(poll_interval);
+    }
+    // все партии по порядку номеров в формате games.bin игры (для tuner и nnue_trainer)
+    ofstream fout(dir / "games.bin", ios_base::binary | ios_base::trunc);
+    for (size_t id = 0; id < games; ++id)
+    {
+        ifstream fin(dir / "results" / (job_name(id) + ".rec"), ios_base::binary);
+        fout << fin.rdbuf();
+    }
+    fout.close();
+    publish(dir / "done", "", process_name());
+
+    const double points = score[0] + 0.5 * score[1];
+    const double ratio = games ? points / double(games) : 0.5;
+    json res = {{"games", games},
+                {"a", {{"wins", score[0]}, {"draws", score[1]}, {"losses", score[2]}}},
+                {"score", ratio},
+                {"elo", nullptr}};
+    // разница в рейтинге Эло A над B по доле очков
+    if (ratio > 0 && ratio < 1)
+        res["elo"] = -400 * log10(1 / ratio - 1);
+    cout << res.dump(2) << endl;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const string mode = argc > 1 ? argv[1] : "";
+    try
+    {
+        if (mode == "worker" && argc > 2)
+            return run_worker(argv[2]);
+        if (mode == "coordinator" && argc > 5)
+        {
+            const size_t games = create_queue(argv[2], argv[3], argv[4], stoul(argv[5]), argc > 6 ? argv[6] : "");
+            return collect(argv[2], games);
+        }
+        if (mode == "local" && argc > 6)
+        {
+            const size_t games = create_queue(argv[2], argv[3], argv[4], stoul(argv[5]), argc > 7 ? argv[7] : "");
+            // рабочие - отдельные процессы на этой машине с той же очередью, что и на кластере
+            vector<pid_t> workers;
+            for (int k = 0; k < max(1, atoi(argv[6])); ++k)
+            {
+                const pid_t pid = fork();
+                if (pid < 0)
+                    throw runtime_error("fork failed");
+                if (pid == 0)
+                {
+                    // рабочий не возвращается в main: раскрутка стека и выход через exit второй раз выполнили бы
+                    // деструкторы и обработчики atexit, унаследованные от координатора
+                    int code = 1;
+                    try
+                    {
+                        code = run_worker(argv[2]);
+                    }
+                    catch (const exception &e)
+                    {
+                        cerr << e.what() << endl;
+                    }
+                    catch (...)
+                    {
+                        cerr << "worker failed" << endl;
+                    }
+                    _exit(code);
+                }
+                workers.push_back(pid);
+            }
+            const int res = collect(argv[2], games);
+            for (const pid_t pid : workers)
+                waitpid(pid, nullptr, 0);
+            return res;
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    cerr << "usage: match coordinator <dir> <settings A> <settings B> <games> [openings]\n"
+            "       match worker <dir>\n"
+            "       match local <dir> <settings A> <settings B> <games> <workers> [openings]"
+         << endl;
+    return 1;
+}
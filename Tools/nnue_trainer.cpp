@@ -0,0 +1,259 @@
+// обучение сети для оценки "NNUE" по записанным партиям самоигры (games.bin):
+// сеть учится предсказывать результат партии по позиции, затем веса квантуются в nnue.bin.
+// запуск: nnue_trainer [games.bin] [nnue.bin] [число эпох] [число потоков]
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "../Game/Nnue_eval.h"
+#include "../Models/Record.h"
+
+// позиция обучающей выборки: номера входов с фигурами и результат для белых
+struct train_pos
+{
+    uint8_t features[24];
+    uint8_t count;
+    float result;
+};
+
+// сеть с весами float, повторяет квантованную: ограниченный ReLU в [0, 1] после первого и второго слоев
+struct float_net
+{
+    static const size_t PARAMS = NNUE_INPUTS * NNUE_L1 + NNUE_L1 + NNUE_L2 * NNUE_L1 + NNUE_L2 + NNUE_L2 + 1;
+    vector<float> p = vector<float>(PARAMS, 0);
+
+    float *w1(const int input)
+    {
+        return p.data() + input * NNUE_L1;
+    }
+    float *b1()
+    {
+        return p.data() + NNUE_INPUTS * NNUE_L1;
+    }
+    float *w2(const int out)
+    {
+        return b1() + NNUE_L1 + out * NNUE_L1;
+    }
+    float *b2()
+    {
+        return w2(NNUE_L2);
+    }
+    float *w3()
+    {
+        return b2() + NNUE_L2;
+    }
+    float *b3()
+    {
+        return w3() + NNUE_L2;
+    }
+
+    // прямой проход, при grad != nullptr - добавление градиента логарифмической функции потерь
+    float forward(const train_pos &pos, float *grad)
+    {
+        float acc[NNUE_L1], a1[NNUE_L1], z2[NNUE_L2], a2[NNUE_L2];
+        copy(b1(), b1() + NNUE_L1, acc);
+        for (int f = 0; f < pos.count; ++f)
+        {
+            const float *row = w1(pos.features[f]);
+            for (int i = 0; i < NNUE_L1; ++i)
+                acc[i] += row[i];
+        }
+        for (int i = 0; i < NNUE_L1; ++i)
+            a1[i] = min(1.0f, max(0.0f, acc[i]));
+        float z = *b3();
+        for (int o = 0; o < NNUE_L2; ++o)
+        {
+            const float *row = w2(o);
+            z2[o] = b2()[o];
+            for (int i = 0; i < NNUE_L1; ++i)
+                z2[o] += row[i] * a1[i];
+            a2[o] = min(1.0f, max(0.0f, z2[o]));
+            z += w3()[o] * a2[o];
+        }
+        const float p = 1 / (1 + exp(-z));
+        if (!grad)
+            return z;
+        // обратный проход
+        float *g = grad;
+        const float dz = p - pos.result;
+        float da1[NNUE_L1] = {};
+        float *g_w2 = g + NNUE_INPUTS * NNUE_L1 + NNUE_L1;
+        float *g_b2 = g_w2 + NNUE_L2 * NNUE_L1;
+        float *g_w3 = g_b2 + NNUE_L2;
+        for (int o = 0; o < NNUE_L2; ++o)
+        {
+            g_w3[o] += dz * a2[o];
+            const float dz2 = (z2[o] > 0 && z2[o] < 1) ? dz * w3()[o] : 0;
+            if (dz2 == 0)
+                continue;
+            g_b2[o] += dz2;
+            const float *row = w2(o);
+            for (int i = 0; i < NNUE_L1; ++i)
+            {
+                g_w2[o * NNUE_L1 + i] += dz2 * a1[i];
+                da1[i] += dz2 * row[i];
+            }
+        }
+        g_w3[NNUE_L2] += dz;
+        float *g_b1 = g + NNUE_INPUTS * NNUE_L1;
+        for (int i = 0; i < NNUE_L1; ++i)
+        {
+            const float dacc = (acc[i] > 0 && acc[i] < 1) ? da1[i] : 0;
+            g_b1[i] += dacc;
+            for (int f = 0; f < pos.count; ++f)
+                g[pos.features[f] * NNUE_L1 + i] += dacc;
+        }
+        return z;
+    }
+
+    // квантование весов; ограничения диапазонов поддерживаются во время обучения
+    nnue_net quantize()
+    {
+        nnue_net net;
+        for (int in = 0; in < NNUE_INPUTS; ++in)
+            for (int i = 0; i < NNUE_L1; ++i)
+                net.w1[in][i] = int16_t(lround(w1(in)[i] * NNUE_QA));
+        for (int i = 0; i < NNUE_L1; ++i)
+            net.b1[i] = int16_t(lround(b1()[i] * NNUE_QA));
+        for (int o = 0; o < NNUE_L2; ++o)
+        {
+            for (int i = 0; i < NNUE_L1; ++i)
+                net.w2[o][i] = int8_t(lround(w2(o)[i] * NNUE_QB));
+            net.b2[o] = int32_t(lround(b2()[o] * NNUE_QA * NNUE_QB));
+            net.w3[o] = int16_t(lround(w3()[o] * NNUE_QB));
+        }
+        net.b3 = int32_t(lround(*b3() * NNUE_QA * NNUE_QB));
+        return net;
+    }
+
+    void clamp_weights()
+    {
+        // |w1| <= 8 держит аккумулятор (до 24 фигур) в пределах int16
+        for (int k = 0; k < NNUE_INPUTS * NNUE_L1 + NNUE_L1; ++k)
+            p[k] = min(8.0f, max(-8.0f, p[k]));
+        // веса второго слоя квантуются в int8 с шагом 1/64
+        for (int o = 0; o < NNUE_L2; ++o)
+            for (int i = 0; i < NNUE_L1; ++i)
+                w2(o)[i] = min(127.0f / NNUE_QB, max(-127.0f / NNUE_QB, w2(o)[i]));
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    const string games_path = argc > 1 ? argv[1] : project_path + "games.bin";
+    const string net_path = argc > 2 ? argv[2] : project_path + "nnue.bin";
+    const int epochs = argc > 3 ? atoi(argv[3]) : 10;
+    const unsigned threads = max(1u, argc > 4 ? unsigned(atoi(argv[4])) : thread::hardware_concurrency());
+
+    // загрузка позиций
+    auto start = chrono::steady_clock::now();
+    ifstream fin(games_path, ios_base::binary);
+    if (!fin)
+    {
+        cerr << "can't open " << games_path << endl;
+        return 1;
+    }
+    vector<train_pos> set;
+    game_record record;
+    while (record.read(fin))
+    {
+        for (const auto &pos : record.positions)
+        {
+            train_pos tp;
+            tp.count = 0;
+            tp.result = record.result == 1 ? 1.0f : record.result == 2 ? 0.0f : 0.5f;
+            const uint32_t pieces[4] = {pos.w, pos.b, pos.wq, pos.bq};
+            for (POS_T piece = 1; piece <= 4; ++piece)
+                for (uint32_t bits = pieces[piece - 1]; bits && tp.count < 24; bits &= bits - 1)
+                    tp.features[tp.count++] = uint8_t(nnue_net::feature(piece, __builtin_ctz(bits)));
+            // позиции с закончившейся игрой оцениваются без сети
+            if ((pos.w | pos.wq) && (pos.b | pos.bq))
+                set.push_back(tp);
+        }
+    }
+    if (set.empty())
+    {
+        cerr << "no positions in " << games_path << endl;
+        return 1;
+    }
+    cout << "loaded " << set.size() << " positions" << endl;
+
+    // инициализация и обучение (Adam на мини-пакетах, градиент пакета считается в нескольких потоках)
+    mt19937 rng(0);
+    float_net net;
+    normal_distribution<float> init(0, 0.1f);
+    for (auto &w : net.p)
+        w = init(rng);
+    const size_t batch = 1024;
+    const float lr = 1e-3f, beta1 = 0.9f, beta2 = 0.999f, eps = 1e-8f;
+    vector<float> m(float_net::PARAMS, 0), v(float_net::PARAMS, 0), grad(float_net::PARAMS);
+    vector<vector<float>> part_grad(threads, vector<float>(float_net::PARAMS));
+    vector<double> part_loss(threads);
+    long long step = 0;
+    for (int epoch = 1; epoch <= epochs; ++epoch)
+    {
+        shuffle(set.begin(), set.end(), rng);
+        double epoch_loss = 0;
+        for (size_t from = 0; from < set.size(); from += batch)
+        {
+            const size_t to = min(set.size(), from + batch);
+            vector<thread> pool;
+            for (unsigned t = 0; t < threads; ++t)
+            {
+                pool.emplace_back([&, t]() {
+                    fill(part_grad[t].begin(), part_grad[t].end(), 0.0f);
+                    part_loss[t] = 0;
+                    for (size_t i = from + t; i < to; i += threads)
+                    {
+                        const float z = net.forward(set[i], part_grad[t].data());
+                        const float p = 1 / (1 + exp(-z));
+                        const float r = set[i].result;
+                        part_loss[t] -= r * log(max(p, 1e-7f)) + (1 - r) * log(max(1 - p, 1e-7f));
+                    }
+                });
+            }
+            for (auto &th : pool)
+                th.join();
+            fill(grad.begin(), grad.end(), 0.0f);
+            for (unsigned t = 0; t < threads; ++t)
+            {
+                epoch_loss += part_loss[t];
+                for (size_t k = 0; k < grad.size(); ++k)
+                    grad[k] += part_grad[t][k];
+            }
+            ++step;
+            const float corr1 = 1 - pow(beta1, float(step)), corr2 = 1 - pow(beta2, float(step));
+            for (size_t k = 0; k < grad.size(); ++k)
+            {
+                const float g = grad[k] / (to - from);
+                m[k] = beta1 * m[k] + (1 - beta1) * g;
+                v[k] = beta2 * v[k] + (1 - beta2) * g * g;
+                net.p[k] -= lr * (m[k] / corr1) / (sqrt(v[k] / corr2) + eps);
+            }
+            net.clamp_weights();
+        }
+        cout << "epoch " << epoch << ": loss " << epoch_loss / set.size() << endl;
+    }
+
+    // квантование и проверка расхождения с float-сетью
+    const nnue_net qnet = net.quantize();
+    qnet.save(net_path);
+    Nnue_eval check(net_path);
+    double diff = 0;
+    const size_t samples = min<size_t>(set.size(), 10000);
+    for (size_t i = 0; i < samples; ++i)
+    {
+        packed_pos pos;
+        for (int f = 0; f < set[i].count; ++f)
+        {
+            const int piece = set[i].features[f] / 32, bit = set[i].features[f] % 32;
+            (piece == 0 ? pos.w : piece == 1 ? pos.b : piece == 2 ? pos.wq : pos.bq) |= uint32_t(1) << bit;
+        }
+        diff += fabs(log(check.score(pos, false)) - net.forward(set[i], nullptr));
+    }
+    cout << "quantization error " << diff / samples << ", saved to " << net_path << " in "
+         << (int)chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " millisec" << endl;
+    return 0;
+}
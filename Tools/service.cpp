@@ -0,0 +1,364 @@
+// долгоживущий сервис анализа для многих партий сразу: один процесс с общей таблицей транспозиций
+// и пулом потоков поиска принимает клиентов через локальный сокет (Unix domain socket).
+// подключение - сессия с тем же протоколом, что у Tools/engine.cpp:
+//   position ..., go [depth N] [movetime MS] [nodes N], stop, isready, stats, quit
+// запросы go всех сессий попадают к планировщику, который раздает их потокам по кругу между сессиями:
+// сессия с длинной очередью запросов не задерживает остальные. запросы не объединяются в пакеты:
+// каждый ищется отдельно одним потоком, планировщик только выбирает порядок; общее у поисков разных
+// позиций - таблица транспозиций. stop отменяет все запросы сессии, отправленные до него, в очереди и в поиске.
+// у каждого запроса бюджет времени (movetime или бюджет по умолчанию), ожидание в очереди входит в бюджет;
+// поиск прерывается по сроку и внутри итерации.
+// stats выдает перцентили задержки запросов сессии (от go до bestmove).
+// запуск: service [путь к сокету] [число потоков] [бюджет по умолчанию в мс]
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "../Game/Analysis.h"
+
+// подключенный клиент
+struct session
+{
+    int fd;
+    int id;
+    string position = "startpos"; // аргументы последней команды position
+    atomic<bool> closed{false};
+    mutex out_mutex;
+    mutex stats_mutex;
+    vector<double> latencies; // задержки выполненных запросов в мс
+    mutex stops_mutex;
+    vector<shared_ptr<atomic<bool>>> stops; // флаги остановки запросов в очереди и в поиске
+
+    session(const int fd, const int id) : fd(fd), id(id)
+    {
+    }
+
+    ~session()
+    {
+        close(fd);
+    }
+
+    // отправка строки клиенту, ошибки отключившегося клиента игнорируются
+    void send_line(const string &line)
+    {
+        if (closed)
+            return;
+        lock_guard<mutex> lock(out_mutex);
+        const string text = line + "\n";
+        size_t sent = 0;
+        while (sent < text.size())
+        {
+            const ssize_t res = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+            if (res <= 0)
+                return;
+            sent += size_t(res);
+        }
+    }
+
+    // флаг остановки нового запроса: stop отменяет запросы, отправленные до него, но не после
+    shared_ptr<atomic<bool>> new_stop()
+    {
+        auto stop = make_shared<atomic<bool>>(false);
+        lock_guard<mutex> lock(stops_mutex);
+        stops.push_back(stop);
+        return stop;
+    }
+
+    // запрос выполнен, его флаг больше не нужен
+    void release_stop(const shared_ptr<atomic<bool>> &stop)
+    {
+        lock_guard<mutex> lock(stops_mutex);
+        stops.erase(remove(stops.begin(), stops.end(), stop), stops.end());
+    }
+
+    // остановка всех ждущих и идущих запросов сессии (stop или отключение)
+    void stop_all()
+    {
+        lock_guard<mutex> lock(stops_mutex);
+        for (const auto &stop : stops)
+            *stop = true;
+        stops.clear();
+    }
+
+    void add_latency(const double ms)
+    {
+        lock_guard<mutex> lock(stats_mutex);
+        latencies.push_back(ms);
+    }
+
+    // "requests N p50 X p90 Y p99 Z max W" по задержкам в мс
+    string stats()
+    {
+        lock_guard<mutex> lock(stats_mutex);
+        if (latencies.empty())
+            return "requests 0";
+        vector<double> sorted = latencies;
+        sort(sorted.begin(), sorted.end());
+        // перцентиль по ближайшему рангу
+        auto percentile = [&sorted](const double p) {
+            const size_t rank = size_t(ceil(p / 100 * sorted.size()));
+            return to_string(lround(sorted[max<size_t>(rank, 1) - 1]));
+        };
+        return "requests " + to_string(sorted.size()) + " p50 " + percentile(50) + " p90 " + percentile(90) +
+               " p99 " + percentile(99) + " max " + to_string(lround(sorted.back()));
+    }
+};
+
+// запрос поиска от сессии
+struct request
+{
+    shared_ptr<session> owner;
+    shared_ptr<atomic<bool>> stop; // остановка этого запроса
+    string position;
+    search_limits limits;
+    chrono::steady_clock::time_point queued;
+};
+
+// очередь запросов с круговым обходом сессий: каждый проход берет не больше одного запроса от сессии
+class Scheduler
+{
+public:
+    void push(request req)
+    {
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            auto &queue = queues[req.owner->id];
+            if (queue.empty())
+                ring.push_back(req.owner->id);
+            queue.push_back(move(req));
+        }
+        ready.notify_one();
+    }
+
+    // следующий запрос, false после shutdown
+    bool pop(request &req)
+    {
+        unique_lock<mutex> lock(queue_mutex);
+        ready.wait(lock, [this]() { return !ring.empty() || is_shutdown; });
+        if (ring.empty())
+            return false;
+        const int id = ring.front();
+        ring.pop_front();
+        auto &queue = queues[id];
+        req = move(queue.front());
+        queue.pop_front();
+        // у сессии остались запросы - она встает в конец круга
+        if (queue.empty())
+            queues.erase(id);
+        else
+            ring.push_back(id);
+        return true;
+    }
+
+    void shutdown()
+    {
+        {
+            lock_guard<mutex> lock(queue_mutex);
+            is_shutdown = true;
+        }
+        ready.notify_all();
+    }
+
+private:
+    mutex queue_mutex;
+    condition_variable ready;
+    map<int, deque<request>> queues; // очереди запросов по номерам сессий
+    deque<int> ring;                 // сессии с запросами в порядке обслуживания
+    bool is_shutdown = false;
+};
+
+class Service
+{
+public:
+    Service(const unsigned threads, const long long budget_ms)
+        : tt(config.snapshot()->tt_size_mb), budget_ms(budget_ms)
+    {
+        // новые настройки поиска и оценки потоки берут перед следующим запросом;
+        // размер общей таблицы меняется только при перезапуске
+        config.watch([this](const string &error) {
+            lock_guard<mutex> lock(log_mutex);
+            cout << (error.empty() ? string("settings reloaded") : error) << endl;
+        });
+        // поиски создаются заранее: конструктор Logic читает настройки и загружает оценку
+        for (unsigned t = 0; t < threads; ++t)
+            analyses.push_back(make_unique<Analysis>(&config, &tt));
+        for (unsigned t = 0; t < threads; ++t)
+            workers.emplace_back(&Service::work, this, analyses[t].get());
+    }
+
+    ~Service()
+    {
+        scheduler.shutdown();
+        for (auto &th : workers)
+            th.join();
+    }
+
+    // прием подключений, на каждую сессию свой поток чтения команд
+    int listen_on(const string &path)
+    {
+        const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (server < 0 || path.size() >= sizeof(addr.sun_path))
+        {
+            cerr << "can't create socket " << path << endl;
+            return 1;
+        }
+        path.copy(addr.sun_path, path.size());
+        unlink(path.c_str());
+        if (bind(server, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(server, 64) != 0)
+        {
+            cerr << "can't listen on " << path << endl;
+            return 1;
+        }
+        cout << "listening on " << path << " with " << workers.size() << " threads, TT " << tt.size_mb() << " MB"
+             << endl;
+        for (int id = 1;; ++id)
+        {
+            const int fd = accept(server, nullptr, nullptr);
+            if (fd < 0)
+                continue;
+            thread(&Service::serve, this, make_shared<session>(fd, id)).detach();
+        }
+    }
+
+private:
+    // чтение команд сессии до quit или отключения
+    void serve(shared_ptr<session> s)
+    {
+        string buffer;
+        char chunk[4096];
+        bool quit = false;
+        while (!quit)
+        {
+            const ssize_t n = recv(s->fd, chunk, sizeof(chunk), 0);
+            if (n <= 0)
+                break;
+            buffer.append(chunk, size_t(n));
+            size_t end;
+            while (!quit && (end = buffer.find('\n')) != string::npos)
+            {
+                string line = buffer.substr(0, end);
+                buffer.erase(0, end + 1);
+                if (!line.empty() && line.back() == '\r')
+                    line.pop_back();
+                quit = !command(s, line);
+            }
+        }
+        s->stop_all();
+        s->closed = true;
+        lock_guard<mutex> lock(log_mutex);
+        cout << "session " << s->id << " closed: " << s->stats() << endl;
+    }
+
+    // команда сессии, false для quit
+    bool command(const shared_ptr<session> &s, const string &line)
+    {
+        istringstream in(line);
+        string cmd;
+        in >> cmd;
+        if (cmd == "isready")
+            s->send_line("readyok");
+        else if (cmd == "position")
+        {
+            getline(in, s->position);
+        }
+        else if (cmd == "go")
+        {
+            request req;
+            req.owner = s;
+            req.position = s->position;
+            req.limits = search_limits::parse(in);
+            req.queued = chrono::steady_clock::now();
+            req.stop = s->new_stop();
+            scheduler.push(move(req));
+        }
+        else if (cmd == "stop")
+            s->stop_all();
+        else if (cmd == "stats")
+            s->send_line("info string " + s->stats());
+        else if (cmd == "quit")
+            return false;
+        else if (!cmd.empty())
+            s->send_line("info string unknown command " + cmd);
+        return true;
+    }
+
+    // поток поиска: запросы из планировщика с оставшимся бюджетом времени
+    void work(Analysis *analysis)
+    {
+        request req;
+        while (scheduler.pop(req))
+        {
+            session &s = *req.owner;
+            if (s.closed)
+            {
+                req = request();
+                continue;
+            }
+            // ошибка одного запроса не должна останавливать поток пула и остальные сессии
+            vector<move_pos> best;
+            try
+            {
+                const long long waited =
+                    chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - req.queued).count();
+                search_limits limits = req.limits;
+                // глубина 1 ищется всегда, даже если бюджет ушел на ожидание;
+                // детерминированный поиск получает весь бюджет, иначе результат зависел бы от очереди
+                analysis->logic.update_settings();
+                const long long wait = analysis->logic.snapshot()->deterministic ? 0 : waited;
+                limits.movetime = max(1LL, (limits.movetime ? limits.movetime : budget_ms) - wait);
+                istringstream position(req.position);
+                const string error = analysis->set_position(position);
+                if (!error.empty())
+                    s.send_line("info string " + error);
+                best = analysis->search(limits, *req.stop,
+                                        [&s](const search_info &info) { s.send_line(info.text()); });
+            }
+            catch (const exception &e)
+            {
+                s.send_line(string("info string ") + e.what());
+                best.clear();
+            }
+            s.release_stop(req.stop);
+            // задержка записывается до ответа, чтобы следующая команда stats ее уже учитывала
+            s.add_latency(chrono::duration<double, milli>(chrono::steady_clock::now() - req.queued).count());
+            s.send_line("bestmove " + (best.empty() ? string("none") : notation::move(best)));
+            req = request();
+        }
+    }
+
+    mutex log_mutex; // вывод статистики сессий и сообщений о настройках
+    Config config;
+    Transposition tt;                      // общая таблица транспозиций всех потоков
+    long long budget_ms;                   // бюджет запроса без movetime
+    Scheduler scheduler;                   // очередь запросов всех сессий
+    vector<unique_ptr<Analysis>> analyses; // поиск каждого потока
+    vector<thread> workers;                // пул потоков поиска
+};
+
+int main(int argc, char *argv[])
+{
+    const string path = argc > 1 ? argv[1] : "checkers.sock";
+    const unsigned threads = max(1u, argc > 2 ? unsigned(atoi(argv[2])) : thread::hardware_concurrency());
+    const long long budget_ms = argc > 3 ? atoll(argv[3]) : 1000;
+    try
+    {
+        Service service(threads, budget_ms);
+        return service.listen_on(path);
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+}
@@ -0,0 +1,204 @@
+// подбор весов оценки позиции по записанным партиям (метод Texel):
+// оценка переводится в вероятность победы логистической функцией,
+// веса всех слагаемых оценки подбираются градиентным спуском по логарифмической функции потерь.
+// запуск: tuner [games.bin] [weights.json] [число итераций] [число потоков]
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#include "../Game/Batch_eval.h"
+#include "../Models/Record.h"
+
+// компактный набор позиций в памяти: признаки обеих сторон по байту на значение
+struct tuning_set
+{
+    vector<uint8_t> features[2][TERMS_COUNT]; // признаки белых [0] и черных [1] по слагаемым оценки
+    vector<uint8_t> result;                   // результат для белых: 0 - поражение, 1 - ничья, 2 - победа
+
+    void push(const packed_pos &pos, const uint8_t game_result)
+    {
+        const uint32_t empty = ~(pos.w | pos.b | pos.wq | pos.bq);
+        int fw[TERMS_COUNT], fb[TERMS_COUNT];
+        Batch_eval::side_features(pos.w, pos.wq, empty, true, fw);
+        Batch_eval::side_features(pos.b, pos.bq, empty, false, fb);
+        // позиции с закончившейся игрой ничего не говорят о весах
+        if (fw[MAN] + fw[KING] == 0 || fb[MAN] + fb[KING] == 0)
+            return;
+        for (int t = 0; t < TERMS_COUNT; ++t)
+        {
+            features[0][t].push_back(uint8_t(fw[t]));
+            features[1][t].push_back(uint8_t(fb[t]));
+        }
+        result.push_back(game_result == 1 ? 2 : game_result == 2 ? 0 : 1);
+    }
+
+    size_t size() const
+    {
+        return result.size();
+    }
+};
+
+class Tuner
+{
+public:
+    Tuner(const tuning_set &set, const unsigned threads) : set(set), threads(max(1u, threads))
+    {
+    }
+
+    // средняя логарифмическая функция потерь и, если grad не nullptr, ее градиент по весам слагаемых
+    double loss(const eval_weights &c, const double k, double *grad = nullptr) const
+    {
+        vector<double> part_loss(threads, 0);
+        vector<vector<double>> part_grad(threads, vector<double>(TERMS_COUNT, 0));
+        vector<thread> pool;
+        const size_t chunk = (set.size() + threads - 1) / threads;
+        for (unsigned t = 0; t < threads; ++t)
+        {
+            pool.emplace_back([&, t]() {
+                const size_t from = t * chunk, to = min(set.size(), from + chunk);
+                double l = 0;
+                vector<double> &g = part_grad[t];
+                for (size_t i = from; i < to; ++i)
+                {
+                    double ws = 0, bs = 0;
+                    for (int term = 0; term < TERMS_COUNT; ++term)
+                    {
+                        ws += c.weight[term] * set.features[0][term][i];
+                        bs += c.weight[term] * set.features[1][term][i];
+                    }
+                    ws = max(ws, 1e-9);
+                    bs = max(bs, 1e-9);
+                    const double logit = k * (log(ws) - log(bs));
+                    const double p = 1 / (1 + exp(-logit));
+                    const double r = set.result[i] * 0.5;
+                    l -= r * log(max(p, 1e-12)) + (1 - r) * log(max(1 - p, 1e-12));
+                    if (grad)
+                    {
+                        const double d = (p - r) * k;
+                        for (int term = 0; term < TERMS_COUNT; ++term)
+                        {
+                            g[term] += d * (set.features[0][term][i] / ws - set.features[1][term][i] / bs);
+                        }
+                    }
+                }
+                part_loss[t] = l;
+            });
+        }
+        for (auto &th : pool)
+            th.join();
+        double l = 0;
+        for (unsigned t = 0; t < threads; ++t)
+        {
+            l += part_loss[t];
+        }
+        if (grad)
+        {
+            for (int term = 0; term < TERMS_COUNT; ++term)
+            {
+                grad[term] = 0;
+                for (unsigned t = 0; t < threads; ++t)
+                    grad[term] += part_grad[t][term];
+                grad[term] /= set.size();
+            }
+        }
+        return l / set.size();
+    }
+
+    // подбор масштаба логистической функции для исходных весов (золотое сечение)
+    double fit_k(const eval_weights &c) const
+    {
+        double lo = 0.01, hi = 20;
+        const double phi = (sqrt(5.0) - 1) / 2;
+        for (int it = 0; it < 60; ++it)
+        {
+            const double m1 = hi - phi * (hi - lo), m2 = lo + phi * (hi - lo);
+            if (loss(c, m1) < loss(c, m2))
+                hi = m2;
+            else
+                lo = m1;
+        }
+        return (lo + hi) / 2;
+    }
+
+    // градиентный спуск (Adam) по всем весам, кроме веса шашки - он задает масштаб оценки.
+    // веса не опускаются ниже нуля, чтобы оценка стороны оставалась положительной
+    eval_weights tune(eval_weights c, const double k, const int iterations) const
+    {
+        const double lr = 0.01, beta1 = 0.9, beta2 = 0.999, eps = 1e-8;
+        double m[TERMS_COUNT] = {}, v[TERMS_COUNT] = {}, grad[TERMS_COUNT];
+        for (int it = 1; it <= iterations; ++it)
+        {
+            const double l = loss(c, k, grad);
+            const double corr1 = 1 - pow(beta1, it), corr2 = 1 - pow(beta2, it);
+            for (int term = 0; term < TERMS_COUNT; ++term)
+            {
+                if (term == MAN)
+                    continue;
+                m[term] = beta1 * m[term] + (1 - beta1) * grad[term];
+                v[term] = beta2 * v[term] + (1 - beta2) * grad[term] * grad[term];
+                // шаг пропорционален величине веса: вес дамки на два порядка больше бонуса за ряд
+                const double step = lr * max(c.weight[term], 0.1);
+                c.weight[term] -= step * (m[term] / corr1) / (sqrt(v[term] / corr2) + eps);
+                c.weight[term] = max(c.weight[term], 0.0);
+            }
+            if (it % 50 == 0 || it == iterations)
+            {
+                cout << "iteration " << it << ": loss " << l << ", weights " << c.to_json().dump() << endl;
+            }
+        }
+        return c;
+    }
+
+private:
+    const tuning_set &set;
+    unsigned threads;
+};
+
+int main(int argc, char *argv[])
+{
+    const string games_path = argc > 1 ? argv[1] : project_path + "games.bin";
+    const string weights_path = argc > 2 ? argv[2] : project_path + "weights.json";
+    const int iterations = argc > 3 ? atoi(argv[3]) : 500;
+    const unsigned threads = argc > 4 ? unsigned(atoi(argv[4])) : thread::hardware_concurrency();
+
+    // загрузка партий в компактный набор позиций
+    auto start = chrono::steady_clock::now();
+    ifstream fin(games_path, ios_base::binary);
+    if (!fin)
+    {
+        cerr << "can't open " << games_path << endl;
+        return 1;
+    }
+    tuning_set set;
+    game_record record;
+    size_t games = 0;
+    while (record.read(fin))
+    {
+        ++games;
+        for (const auto &pos : record.positions)
+        {
+            set.push(pos, record.result);
+        }
+    }
+    if (set.size() == 0)
+    {
+        cerr << "no positions in " << games_path << endl;
+        return 1;
+    }
+    cout << "loaded " << set.size() << " positions from " << games << " games in "
+         << (int)chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " millisec" << endl;
+
+    // исходные веса - текущие подобранные или NumberAndPotential
+    Tuner tuner(set, threads);
+    eval_weights coefs;
+    coefs.load(weights_path);
+    const double k = tuner.fit_k(coefs);
+    cout << "scale " << k << ", initial loss " << tuner.loss(coefs, k) << endl;
+    coefs = tuner.tune(coefs, k, iterations);
+    coefs.save(weights_path);
+    cout << "weights saved to " << weights_path << " in "
+         << (int)chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " millisec" << endl;
+    return 0;
+}
@@ -1,9 +1,23 @@
 #include "Game/Game.h"
 
+#ifdef _WIN32
 int WinMain(int argc, char *argv[])
+#else
+int main(int argc, char *argv[])
+#endif
 {
-    Game g;
-    g.play();
+    // ошибки в settings.json записываются в лог
+    try
+    {
+        Game g;
+        g.play();
+    }
+    catch (const exception &e)
+    {
+        ofstream fout(project_path + "log.txt", ios_base::app);
+        fout << "Error: " << e.what() << endl;
+        return 1;
+    }
 
     return 0;
 }